@@ -0,0 +1,145 @@
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "mips_batch.hpp"
+
+//the jobs one worker still has to do. The owner takes from the front, the others steal from the back.
+//a job is a whole program run, so a lock per queue costs nothing next to it
+struct batch_queue{
+
+    std::mutex lock;
+    std::deque<size_t> jobs;
+};
+
+//gets the next job for worker self: its own first, otherwise stolen. false once every queue is empty (jobs are never added back)
+static bool batch_take(std::vector<batch_queue>& queues, size_t self, size_t& job){
+
+    {
+        std::lock_guard<std::mutex> guard(queues[self].lock);
+
+        if(!queues[self].jobs.empty()){
+
+            job = queues[self].jobs.front();
+            queues[self].jobs.pop_front();
+            return true;
+        }
+    }
+
+    //start looking after itself, so the thieves don't all go for the same queue
+    for(size_t i = 1; i < queues.size(); i++){
+
+        batch_queue& victim = queues[(self + i) % queues.size()];
+
+        std::lock_guard<std::mutex> guard(victim.lock);
+
+        if(!victim.jobs.empty()){
+
+            job = victim.jobs.back();
+            victim.jobs.pop_back();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+static void batch_worker(mips_engine engine, bool guard_pages, const std::vector<std::unique_ptr<mips_simulator> >& binaries, std::vector<mips_job>& jobs, std::vector<batch_queue>& queues, size_t self){
+
+    mips_simulator simulator(engine);
+
+    if(guard_pages){
+        simulator.set_guard_pages(true); //stays paged if it can't
+    }
+
+    size_t index;
+
+    while(batch_take(queues, self, index)){
+
+        mips_job& job = jobs[index];
+
+        //same binary as the last job: only a reset, and the engine keeps what it found
+        simulator.load_shared(*binaries[job.binary]);
+
+        job.output.clear();
+        simulator.get_memory().set_io(&job.input, &job.output);
+
+        job.status = simulator.run(job.max_steps);
+        job.exit_code = mips_exit_code(job.status, simulator.get_registers());
+    }
+}
+
+mips_batch::mips_batch(mips_engine engine_in){
+
+    engine = engine_in;
+    guard_pages = false;
+}
+
+void mips_batch::set_guard_pages(bool on){
+
+    guard_pages = on;
+}
+
+int mips_batch::add_binary(const char* image, uint32_t size){
+
+    std::unique_ptr<mips_simulator> binary(new mips_simulator(engine));
+
+    if(!binary->load(image, size)){
+        return -1;
+    }
+
+    binaries.push_back(std::move(binary));
+
+    return binaries.size() - 1;
+}
+
+int mips_batch::add_binary(const std::string& location){
+
+    std::unique_ptr<mips_simulator> binary(new mips_simulator(engine));
+
+    if(!binary->load_file(location)){
+        return -1;
+    }
+
+    binaries.push_back(std::move(binary));
+
+    return binaries.size() - 1;
+}
+
+void mips_batch::run(std::vector<mips_job>& jobs, unsigned threads){
+
+    if(threads == 0){
+        threads = std::thread::hardware_concurrency();
+    }
+    if(threads > jobs.size()){
+        threads = jobs.size();
+    }
+    if(threads == 0){ //no jobs (or the core count is unknown and there is one)
+        threads = 1;
+    }
+
+    //hand out the jobs in order, in one run of them per worker, so jobs for the same binary tend to stay on the same worker
+    std::vector<batch_queue> queues(threads);
+
+    for(size_t i = 0; i < jobs.size(); i++){
+        queues[i * threads / jobs.size()].jobs.push_back(i);
+    }
+
+    std::vector<std::thread> workers;
+
+    for(unsigned i = 1; i < threads; i++){
+        workers.push_back(std::thread(batch_worker, engine, guard_pages, std::cref(binaries), std::ref(jobs), std::ref(queues), i));
+    }
+
+    //the calling thread is worker 0
+    batch_worker(engine, guard_pages, binaries, jobs, queues, 0);
+
+    for(size_t i = 0; i < workers.size(); i++){
+        workers[i].join();
+    }
+}
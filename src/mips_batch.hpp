@@ -0,0 +1,53 @@
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mips_simulator.hpp"
+
+#ifndef MIPS_BATCH
+#define MIPS_BATCH
+
+//one run in a batch: which binary, what GETC reads, and (after the batch ran) how it stopped and what it printed
+struct mips_job{
+
+    uint32_t binary;     //number add_binary gave the binary
+    std::string input;   //what GETC reads, it gets EOF after the last character
+    uint64_t max_steps;  //step budget, the job stops with MIPS_STEP_LIMIT if it runs out
+
+    mips_status status;
+    int exit_code;       //as mips_exit_code
+    std::string output;  //everything written to PUTC
+
+    mips_job() : binary(0), max_steps(UINT64_MAX), status(MIPS_OK), exit_code(0) {}
+};
+
+//runs many jobs over a few binaries on a pool of threads, in one process.
+//every binary is loaded and decoded once, and shared read only by all the workers. A worker only has its own registers and
+//data memory (one mips_simulator, reset between jobs), and its own queue of jobs. When its queue is empty it steals from the
+//back of the others, so one long run doesn't leave the other cores idle
+class mips_batch{
+
+    public:
+
+    mips_batch(mips_engine engine_in = ENGINE_BLOCKS);
+
+    //every worker's memory uses guard pages (see mips_simulator::set_guard_pages), if the host can
+    void set_guard_pages(bool on);
+
+    //loads a binary for the jobs to use. Returns its number, or -1 if it can't be loaded (see mips_simulator::load)
+    int add_binary(const char* image, uint32_t size);
+    int add_binary(const std::string& location);
+
+    //runs every job on threads workers (0 for one per core) and fills in their results. Every job has to use a binary that was added
+    void run(std::vector<mips_job>& jobs, unsigned threads = 0);
+
+    private:
+
+    mips_engine engine;
+    bool guard_pages;
+
+    std::vector<std::unique_ptr<mips_simulator> > binaries; //only loaded, never run, the workers share from them
+};
+
+#endif
@@ -0,0 +1,172 @@
+#include <cstdint>
+#include <vector>
+
+#include "mips_blocks.hpp"
+
+//finds the block starting at index (in words from 0x10000000) and adds it to the list. Returns its number
+static int32_t block_find(uint32_t index, uint32_t last_index, const std::vector<mips_decoded>& program, std::vector<mips_block>& blocks){
+
+    mips_block block;
+
+    block.start_pc = 0x10000000 + 4 * index;
+    block.length = 0;
+
+    //go until a branch/jump or an invalid instruction (both end the block), or the end of the binary
+    for(uint32_t i = index; i <= last_index; i++){
+
+        block.length++;
+
+        if(program[i].handler == OP_INVALID || instruction_is_branch(program[i].handler)){
+            break;
+        }
+    }
+
+    block.exit_pc[0] = 0;
+    block.exit_pc[1] = 0;
+    block.exit_block[0] = -1;
+    block.exit_block[1] = -1;
+
+    blocks.push_back(block);
+
+    return blocks.size() - 1;
+}
+
+void mips_block_engine::clear(){
+
+    blocks.clear();
+    block_at.clear();
+}
+
+mips_status mips_block_engine::run(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps){
+
+    //the memory mode doesn't change during a run, so it is only looked at here
+    if(memory.guard_pages()){
+        return run_mode<mips_memory_guarded>(program, memory, registers, steps);
+    }
+
+    return run_mode<mips_memory_paged>(program, memory, registers, steps);
+}
+
+template<class access>
+mips_status mips_block_engine::run_mode(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps){
+
+    uint32_t last_address = memory.read_LAST_INSTR_ADDRESS();
+
+    //the last run stopped between a branch and its delay slot
+    if(registers.in_delay_slot()){
+
+        if(steps == 0){
+            return MIPS_STEP_LIMIT;
+        }
+        steps--;
+
+        mips_status status = instruction_delay_slot<access>(program, memory, registers);
+
+        if(status != MIPS_OK){
+            return status;
+        }
+    }
+
+    //if the PC is outside of the binary, stop and indicate memory error (this replaces the check in the main loop, and only happens when a block isn't linked yet)
+    if(registers.read_pc() < 0x10000000 || registers.read_pc() > last_address){
+        return MIPS_MEMORY_TRAP;
+    }
+
+    uint32_t last_index = (last_address - 0x10000000) / 4;
+
+    if(block_at.empty()){
+        block_at.assign(last_index + 1, -1);
+    }
+
+    uint32_t index = (registers.read_pc() - 0x10000000) / 4;
+    int32_t current = block_at[index];
+
+    if(current < 0){
+        current = block_find(index, last_index, program, blocks);
+        block_at[index] = current;
+    }
+
+    while(1){
+
+        //run the whole block. Only the branch at the end can change the PC to anything but PC + 4
+        const mips_decoded* instr = &program[(blocks[current].start_pc - 0x10000000) / 4];
+        uint32_t length = blocks[current].length;
+
+        //not enough steps left for all of it and a delay slot: run what is allowed one at a time, the next run starts in the middle of the block
+        if(steps <= length){
+
+            for(; steps > 0; steps--){
+
+                mips_status status = instruction_step<access>(program, memory, registers);
+
+                if(status != MIPS_OK){
+                    steps--;
+                    return status;
+                }
+            }
+
+            return MIPS_STEP_LIMIT;
+        }
+
+        steps -= length;
+
+        for(uint32_t i = 0; i < length; i++){
+
+            mips_status status = instruction_execute<access>(instr[i], program, memory, registers);
+
+            if(status != MIPS_OK){
+                steps += length - i - 1; //give back the ones that didn't run
+                return status;
+            }
+        }
+
+        //a taken branch at the end leaves its delay slot to run, as one more step
+        if(registers.in_delay_slot()){
+
+            steps--;
+
+            mips_status status = instruction_delay_slot<access>(program, memory, registers);
+
+            if(status != MIPS_OK){
+                return status;
+            }
+        }
+
+        //follow the link to the next block if this exit was seen before
+        uint32_t pc = registers.read_pc();
+
+        mips_block& block = blocks[current];
+
+        if(block.exit_pc[0] == pc && block.exit_block[0] >= 0){
+            current = block.exit_block[0];
+        }
+        else if(block.exit_pc[1] == pc && block.exit_block[1] >= 0){
+            current = block.exit_block[1];
+        }
+        else{
+
+            if(pc < 0x10000000 || pc > last_address){ //ran off the end of the binary or jumped outside of it
+                return MIPS_MEMORY_TRAP;
+            }
+
+            index = (pc - 0x10000000) / 4;
+
+            int32_t next = block_at[index];
+
+            if(next < 0){
+                next = block_find(index, last_index, program, blocks); //can move the blocks, so block is not used after this
+                block_at[index] = next;
+            }
+
+            //link it if there is a free slot. JR/JALR can have more than 2 targets, the rest are looked up every time
+            int slot = (blocks[current].exit_block[0] < 0) ? 0 : ((blocks[current].exit_block[1] < 0) ? 1 : -1);
+
+            if(slot >= 0){
+                blocks[current].exit_pc[slot] = pc;
+                blocks[current].exit_block[slot] = next;
+            }
+
+            current = next;
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#include <cstdint>
+#include <vector>
+
+#include "mips_memory.hpp"
+#include "mips_registers.hpp"
+#include "mips_breakdown.hpp"
+
+#ifndef MIPS_BLOCKS
+#define MIPS_BLOCKS
+
+//a basic block: a run of predecoded instructions that ends with a branch or jump (a taken branch's delay slot runs right after the block)
+struct mips_block{
+
+    uint32_t start_pc;
+    uint32_t length; //number of instructions, including the branch at the end
+
+    //the two places the block was seen to leave to (taken and not taken), and the block found there. -1 until used
+    uint32_t exit_pc[2];
+    int32_t exit_block[2];
+};
+
+//runs the program one basic block at a time.
+//blocks are found the first time their start address is executed and then linked directly to the blocks they lead to.
+//they are kept between runs, so a run that stopped because of the step budget carries on where it was
+class mips_block_engine{
+
+    public:
+
+    //forgets every block found so far (needed when a different binary gets loaded)
+    void clear();
+
+    //runs from the current PC until the program stops or steps instructions have run, same as program_run_table
+    mips_status run(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps);
+
+    private:
+
+    //run for one memory mode (see mips_memory_paged)
+    template<class access>
+    mips_status run_mode(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps);
+
+    std::vector<mips_block> blocks;
+    std::vector<int32_t> block_at; //which block starts at each instruction, -1 if none found yet
+};
+
+#endif
@@ -1,1358 +1,1710 @@
+#include <iomanip>
+#include <ostream>
+
 #include "mips_breakdown.hpp"
+#include "mips_policy.hpp"
+
+///////////////////////////////////////
+///////////// Decoding ////////////////
+///////////////////////////////////////
+
+//fields that have to be 0 for an encoding to be valid
+enum { ZERO_RS = 1, ZERO_RT = 2, ZERO_RD = 4, ZERO_SHAMT = 8 };
+
+//how the 16 bit immediate gets extended when decoding
+enum { IMM_SIGN, IMM_ZERO, IMM_UPPER, IMM_BRANCH, IMM_JUMP, IMM_SHAMT };
+
+//what one opcode/funct value decodes to
+struct decode_entry{
+
+    uint8_t handler;
+    uint8_t zero_fields;
+    uint8_t immediate_type;
+};
+
+//the lookup tables used by instruction_decode. Every index that is not filled in stays OP_INVALID
+struct decode_tables{
+
+    decode_entry opcode[64]; //indexed by opcode
+    decode_entry funct[64];  //R types (opcode 0), indexed by funct
+    decode_entry regimm[32]; //opcode 1 branches, indexed by rt
+
+    decode_tables(){
+
+        for(int i = 0; i < 64; i++){
+            opcode[i] = {OP_INVALID, 0, IMM_SIGN};
+            funct[i] = {OP_INVALID, 0, IMM_SHAMT};
+        }
+        for(int i = 0; i < 32; i++){
+            regimm[i] = {OP_INVALID, 0, IMM_BRANCH};
+        }
+
+        //R type
+        funct[0b100001] = {OP_ADDU, ZERO_SHAMT, IMM_SHAMT};
+        funct[0b001000] = {OP_JR, ZERO_RT | ZERO_RD | ZERO_SHAMT, IMM_SHAMT};
+        funct[0b100000] = {OP_ADD, ZERO_SHAMT, IMM_SHAMT};
+        funct[0b100100] = {OP_AND, ZERO_SHAMT, IMM_SHAMT};
+        funct[0b011010] = {OP_DIV, ZERO_RD | ZERO_SHAMT, IMM_SHAMT};
+        funct[0b011011] = {OP_DIVU, ZERO_RD | ZERO_SHAMT, IMM_SHAMT};
+        funct[0b001001] = {OP_JALR, ZERO_RT | ZERO_SHAMT, IMM_SHAMT};
+        funct[0b010000] = {OP_MFHI, ZERO_RS | ZERO_RT | ZERO_SHAMT, IMM_SHAMT};
+        funct[0b010010] = {OP_MFLO, ZERO_RS | ZERO_RT | ZERO_SHAMT, IMM_SHAMT};
+        funct[0b010001] = {OP_MTHI, ZERO_RT | ZERO_RD | ZERO_SHAMT, IMM_SHAMT};
+        funct[0b010011] = {OP_MTLO, ZERO_RT | ZERO_RD | ZERO_SHAMT, IMM_SHAMT};
+        funct[0b011000] = {OP_MULT, ZERO_RD | ZERO_SHAMT, IMM_SHAMT};
+        funct[0b011001] = {OP_MULTU, ZERO_RD | ZERO_SHAMT, IMM_SHAMT};
+        funct[0b100101] = {OP_OR, ZERO_SHAMT, IMM_SHAMT};
+        funct[0b000000] = {OP_SLL, ZERO_RS, IMM_SHAMT};
+        funct[0b000100] = {OP_SLLV, ZERO_SHAMT, IMM_SHAMT};
+        funct[0b101010] = {OP_SLT, ZERO_SHAMT, IMM_SHAMT};
+        funct[0b101011] = {OP_SLTU, ZERO_SHAMT, IMM_SHAMT};
+        funct[0b000011] = {OP_SRA, ZERO_RS, IMM_SHAMT};
+        funct[0b000111] = {OP_SRAV, ZERO_SHAMT, IMM_SHAMT};
+        funct[0b000010] = {OP_SRL, ZERO_RS, IMM_SHAMT};
+        funct[0b000110] = {OP_SRLV, ZERO_SHAMT, IMM_SHAMT};
+        funct[0b100010] = {OP_SUB, ZERO_SHAMT, IMM_SHAMT};
+        funct[0b100011] = {OP_SUBU, ZERO_SHAMT, IMM_SHAMT};
+        funct[0b100110] = {OP_XOR, ZERO_SHAMT, IMM_SHAMT};
+
+        //I type
+        opcode[0b001111] = {OP_LUI, ZERO_RS, IMM_UPPER};
+        opcode[0b001001] = {OP_ADDIU, 0, IMM_SIGN};
+        opcode[0b101011] = {OP_SW, 0, IMM_SIGN};
+        opcode[0b100011] = {OP_LW, 0, IMM_SIGN};
+        opcode[0b001101] = {OP_ORI, 0, IMM_ZERO};
+        opcode[0b000101] = {OP_BNE, 0, IMM_BRANCH};
+        opcode[0b001000] = {OP_ADDI, 0, IMM_SIGN};
+        opcode[0b001100] = {OP_ANDI, 0, IMM_ZERO};
+        opcode[0b000100] = {OP_BEQ, 0, IMM_BRANCH};
+        opcode[0b000111] = {OP_BGTZ, ZERO_RT, IMM_BRANCH};
+        opcode[0b000110] = {OP_BLEZ, ZERO_RT, IMM_BRANCH};
+        opcode[0b100000] = {OP_LB, 0, IMM_SIGN};
+        opcode[0b100100] = {OP_LBU, 0, IMM_SIGN};
+        opcode[0b100001] = {OP_LH, 0, IMM_SIGN};
+        opcode[0b100101] = {OP_LHU, 0, IMM_SIGN};
+        opcode[0b100010] = {OP_LWL, 0, IMM_SIGN};
+        opcode[0b100110] = {OP_LWR, 0, IMM_SIGN};
+        opcode[0b101000] = {OP_SB, 0, IMM_SIGN};
+        opcode[0b101001] = {OP_SH, 0, IMM_SIGN};
+        opcode[0b001010] = {OP_SLTI, 0, IMM_SIGN};
+        opcode[0b001011] = {OP_SLTIU, 0, IMM_SIGN};
+        opcode[0b001110] = {OP_XORI, 0, IMM_ZERO};
+
+        //opcode 1 uses rt to tell the branches apart
+        regimm[0b00001] = {OP_BGEZ, 0, IMM_BRANCH};
+        regimm[0b10001] = {OP_BGEZAL, 0, IMM_BRANCH};
+        regimm[0b00000] = {OP_BLTZ, 0, IMM_BRANCH};
+        regimm[0b10000] = {OP_BLTZAL, 0, IMM_BRANCH};
+
+        //J type
+        opcode[0b000010] = {OP_J, 0, IMM_JUMP};
+        opcode[0b000011] = {OP_JAL, 0, IMM_JUMP};
+    }
+};
 
-void instruction_decode_run(uint32_t input, mips_memory& memory, mips_registers& registers){
+static const decode_tables tables;
+
+mips_decoded instruction_decode(uint32_t input){
+
+    mips_decoded instr;
 
-    
     uint8_t opcode = input >> 26 ;
 
-    // std::cerr << "the instruction is " << std::bitset<32>(input) << std::endl;
-    //// std::cerr << "the opcode is " << std::bitset<8>(opcode) << std::endl;
+    //Splitting the instruction into components (not every type uses all of them):
 
-    if (opcode == 0){ // R-type instructions
+    //rs - 1st register operand, or register containing base address (5 bits)
+    instr.rs = (input >> 21) & 0x1F;
 
-        //Splitting the instruction into components:
+    //rt - 2nd register operand, or register destination/source (5 bits)
+    instr.rt = (input >> 16) & 0x1F;
 
-        //rs - 1st register operand (5 bits)
-        uint8_t rs = (input >> 21) & 0x1F;
+    //rd - register destination (5 bits)
+    instr.rd = (input >> 11) & 0x1F;
 
-        // std::cerr << "instruction is " << std::hex << input << " rs = " << rs << " contents = " << registers.read_reg(rs) << std::endl;
+    //shamt - shift amount (5 bits)
+    uint8_t shamt = (input >> 6) & 0x1F;
 
-        //rt - 2nd register operand (5 bits)
-        uint8_t rt = (input >> 16) & 0x1F;
+    //funct - function code (identifies the specific R type instruction) (6 bits)
+    uint8_t funct = input & 0x3F;
 
-        //rd - register destination (5 bits)
-        uint8_t rd = (input >> 11) & 0x1F;
+    //immediate - value or offset (16 bits)
+    uint16_t immediate = input & 0xFFFF;
 
-        //shamt - shift amount (5 bits)
-        uint8_t shamt = (input >> 6) & 0x1F;
+    //look up what the instruction is
+    decode_entry entry;
 
-        //funct - function code (identifies the specific R type instruction) (6 bits)
-        uint8_t funct = input & 0x3F;
+    if(opcode == 0){
+        entry = tables.funct[funct];
+    }
+    else if(opcode == 1){
+        entry = tables.regimm[instr.rt];
+    }
+    else{
+        entry = tables.opcode[opcode];
+    }
 
-        /*
+    //reject encodings with fields set that the instruction does not use (e.g. an ADDU with a shift amount)
+    if(((entry.zero_fields & ZERO_RS) && instr.rs != 0) || ((entry.zero_fields & ZERO_RT) && instr.rt != 0) || ((entry.zero_fields & ZERO_RD) && instr.rd != 0) || ((entry.zero_fields & ZERO_SHAMT) && shamt != 0)){
 
-        // std::cerr << "rs " << std::bitset<8>(rs) << std::endl;
-        // std::cerr << "rt " << std::bitset<8>(rt) << std::endl;
-        // std::cerr << "rd " << std::bitset<8>(rd) << std::endl;
-        // std::cerr << "shamt " << std::bitset<8>(shamt) << std::endl;
-        // std::cerr << "funct " << std::bitset<8>(funct) << std::endl;
+        entry.handler = OP_INVALID;
+    }
 
-        */
+    instr.handler = entry.handler;
 
-        //execute the instruction:
-        return rtype(rs, rt, rd, shamt, funct, memory, registers);
+    //extend the immediate the way the instruction uses it
+    int16_t signed_immediate = immediate;
+    int32_t sign_extended_immediate = signed_immediate;
 
+    if(entry.immediate_type == IMM_SIGN){
+        instr.immediate = sign_extended_immediate;
+    }
+    else if(entry.immediate_type == IMM_ZERO){
+        instr.immediate = immediate;
+    }
+    else if(entry.immediate_type == IMM_UPPER){
+        instr.immediate = immediate << 16;
+    }
+    else if(entry.immediate_type == IMM_BRANCH){
+        //branches are relative to the instruction after them, so the 4 is added here as well
+        instr.immediate = ((uint32_t)sign_extended_immediate << 2) + 4;
+    }
+    else if(entry.immediate_type == IMM_JUMP){
+        //26-bit shortened address of the destination. 2 LSB are removed (since they would be 0), and 4 MSB are removed and assumed to be same as current address
+        instr.immediate = (input & 0x03FFFFFF) << 2;
+    }
+    else{
+        instr.immediate = shamt;
     }
 
-    else if (opcode == 0b001000 || opcode == 0b001001 || opcode == 0b001100 || opcode == 0b000100 || opcode == 0b000001 || opcode == 0b000111 || opcode == 0b000110 || opcode == 0b000101 || opcode == 0b100000 || opcode == 0b100100 || opcode == 0b100001 || opcode == 0b100101 || opcode == 0b001111 || opcode == 0b100011 || opcode == 0b100010 || opcode == 0b100110 || opcode == 0b001101 || opcode == 0b101000 || opcode == 0b001010 || opcode == 0b001011 || opcode == 0b101001 || opcode == 0b101011 || opcode == 0b001110){
-        // I type
+    return instr;
+}
 
-        //Spliting the instruction into components:
+std::vector<mips_decoded> program_decode(mips_memory& memory){
 
-        //rs - register containing base address (5 bits)
-        uint8_t rs = (input >> 21) & 0x1F;
+    //number of words in the binary, rounded up so a partial last word still gets decoded (the missing bytes are 0)
+    uint32_t length = (memory.read_INSTR_SIZE() + 3) / 4;
 
-        //rt - register destination/source (5 bits)
-        uint8_t rt = (input >> 16) & 0x1F;
+    std::vector<mips_decoded> program(length);
 
-        //immediate - value or offset (16 bits)
-        uint16_t immediate = input & 0xFFFF;
+    for(uint32_t i = 0; i < length; i++){
 
-        //execute the instruction:
-        return itype(opcode, rs, rt, immediate, memory, registers);
+        program[i] = instruction_decode(memory.read_INSTR(0x10000000 + 4 * i));
     }
 
-    else if (opcode == 0b000010 || opcode == 0b000011){ // J Type 
+    return program;
+}
 
-        //26-bit shortened address of the destination. 2 LSB are removed (since they would be 0), and 4 MSB are removed and assumed to be same as current address
-        uint32_t short_address = input & 0x07FFFFFF;
+bool instruction_is_branch(uint8_t handler){
 
-        //execute the instruction:
-        return jtype(opcode, short_address, memory, registers);
-    }
+    return handler == OP_JR || handler == OP_JALR || handler == OP_BNE || handler == OP_BEQ || handler == OP_BGEZ || handler == OP_BGEZAL || handler == OP_BGTZ
+        || handler == OP_BLEZ || handler == OP_BLTZ || handler == OP_BLTZAL || handler == OP_J || handler == OP_JAL;
+}
+
+const char* instruction_name(uint8_t handler){
+
+    //indexed by mips_handler, has to stay in the same order as the enum
+    static const char* const names[] = {
+
+        "invalid",
+
+        "addu", "jr", "add", "and", "div", "divu", "jalr", "mfhi", "mflo", "mthi", "mtlo", "mult", "multu",
+        "or", "sll", "sllv", "slt", "sltu", "sra", "srav", "srl", "srlv", "sub", "subu", "xor",
 
-    else { //not a valid opcode
+        "lui", "addiu", "sw", "lw", "ori", "bne", "addi", "andi", "beq", "bgez", "bgezal", "bgtz", "blez",
+        "bltz", "bltzal", "lb", "lbu", "lh", "lhu", "lwl", "lwr", "sb", "sh", "slti", "sltiu", "xori",
 
-        exit(-12);
+        "j", "jal"
+    };
+
+    return (handler <= OP_JAL) ? names[handler] : "invalid";
+}
+
+
+///////////////////////////////////////
+///////////// Handlers ////////////////
+///////////////////////////////////////
+
+//a taken branch: the PC stays on the branch, its delay slot is the next thing that runs (instruction_delay_slot), and then the PC goes to address
+static mips_status branch_to(uint32_t address, mips_registers& registers){
+
+    if(registers.in_delay_slot()){
+
+        //a taken branch in the delay slot of another one. The old recursive handlers never came back from this
+        //(the inner branch ran itself as its own delay slot over and over), so it is treated as an invalid instruction
+        return MIPS_INVALID_INSTRUCTION;
     }
+
+    registers.delay_branch(address);
+
+    return MIPS_OK;
 }
 
-void rtype(uint8_t rs, uint8_t rt, uint8_t rd, uint8_t shamt, uint8_t funct, mips_memory& memory, mips_registers& registers){
+//the delay slot has run (or there was none): go to the branch target
+static mips_status branch_finish(mips_registers& registers){
 
-    //// std::cerr << "entered r type" << std::endl;
-    //ADDU
-    if(funct == 0b100001 && shamt == 0){
+    uint32_t address = registers.read_delay_target();
 
-        // std::cerr << "entered ADDU" << std::endl;
+    registers.end_delay_slot();
 
-        //get the result of the addition of the values in the two registers
-        uint32_t result = registers.read_reg(rs) + registers.read_reg(rt);
+    //if the address points at 0x0, which means the program has finished execution, exit and indicate success
+    if(address == 0){
 
-        //put the result into the destination register
-        registers.write_reg(rd, result);
+        //the exit code is the bottom byte of $2, the caller reads it from there
+        return MIPS_EXITED;
+    }
 
-        //update the program counter
-        registers.next_instruction_normal();
+    //if the address is out of bounds, exit and indicate memory error
+    else if(address < 0x10000000 || address >= 0x11000000){
 
-        //// std::cerr << "exiting ADDU" << std::endl;
+        return MIPS_MEMORY_TRAP;
     }
 
-    //JR
-    else if(funct == 0b001000 && rt == 0 && rd == 0 && shamt == 0){
+    registers.next_instruction_branch(address);
 
-        // std::cerr << "entered JR" << std::endl;
+    return MIPS_OK;
+}
 
-        //reads the address for the jump from the rs register:
-        uint32_t jump_address = registers.read_reg(rs);
+//not a valid instruction
+static mips_status op_invalid(const mips_decoded&, const std::vector<mips_decoded>&, mips_memory&, mips_registers&){
 
-        //if the address from the register is alligned
-        if(jump_address % 4 == 0){
+    return MIPS_INVALID_INSTRUCTION;
+}
 
-            //execute next instruction since there is a branch delay. 
-            //it reads the instruction after the PC (which is PC+4), and then puts it into the instruction breakdown function recursively  
-            
-            // std::cerr << "Current PC: " << registers.read_pc() << ", LAST_INSTR_ADDRESS: " << memory.read_LAST_INSTR_ADDRESS() << std::endl; 
+//ADDU
+static mips_status op_addu(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-            if(registers.read_pc() < memory.read_LAST_INSTR_ADDRESS()){ //only executes the branch delay instruction if it there is an instruction after the JR
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
 
-                instruction_decode_run(memory.read_INSTR(registers.read_pc()+4), memory, registers);
-            }
+    //get the result of the addition of the values in the two registers
+    uint32_t result = registers.read_reg(rs) + registers.read_reg(rt);
 
-            //if the address points at 0x0, which means the program has finished execution, exit and indicate success
-            if(jump_address == 0){
+    //put the result into the destination register
+    registers.write_reg(rd, result);
 
-                uint8_t exit_code = registers.read_reg(2);
+    //update the program counter
+    registers.next_instruction_normal();
 
-                exit(exit_code);
-            }
+    return MIPS_OK;
+}
 
-            //if the address is out of bounds, exit and indicate memory error
-            else if(jump_address < 0x10000000 || jump_address >= 0x11000000){
-               
-                exit(-11);
-            }
+//JR
+static mips_status op_jr(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-            //set the PC to the next instruction.
-            registers.next_instruction_branch(jump_address);
-           
-        }
-        else{
-        
-        //address from the register is not alligned
-            // std::cerr << "JR address not alligned" << std::endl;
-            exit(-11);
-        }
+    uint8_t rs = instr.rs;
+
+    //reads the address for the jump from the rs register:
+    uint32_t jump_address = registers.read_reg(rs);
+
+    //if the address from the register is alligned
+    if(jump_address % 4 == 0){
+
+        //the delay slot runs next, then the PC goes to the target
+        return branch_to(jump_address, registers);
+       
+    }
+    else{
+    
+    //address from the register is not alligned
+        return MIPS_MEMORY_TRAP;
     }
 
-    //ADD
-    else if(funct == 0b100000 && shamt == 0){
+    return MIPS_OK;
+}
 
-        // std::cerr << "entered ADD" << std::endl;
+//ADD
+static mips_status op_add(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        int32_t a = registers.read_reg(rs);
-        int32_t b = registers.read_reg(rt);
-        int32_t sum = a + b;
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
 
-        // std::cerr << "register rs: " << rs << " contents: " << std::hex << a << std::endl;
-        // std::cerr << "register rt: " << rt << " contents: " << std::hex << b << std::endl;
-        // std::cerr << "sum: " << std::hex << sum << std::endl;
+    int32_t a = registers.read_reg(rs);
+    int32_t b = registers.read_reg(rt);
+    int32_t sum = (uint32_t)a + (uint32_t)b; //added as unsigned, signed overflow is undefined in c++
 
 
-        //checking for 2s complement overflow
-        if(((a >= 0) && (b >= 0) && (sum < 0)) || ((a < 0) && (b < 0) && (sum >= 0))){ //overflow detected
+    //checking for 2s complement overflow
+    if(((a >= 0) && (b >= 0) && (sum < 0)) || ((a < 0) && (b < 0) && (sum >= 0))){ //overflow detected
 
-            exit(-10);
-        }
-        else{
+        return MIPS_ARITHMETIC_TRAP;
+    }
+    else{
 
-            registers.write_reg(rd, sum);
-            
-            registers.next_instruction_normal();
-        }
+        registers.write_reg(rd, sum);
+        
+        registers.next_instruction_normal();
     }
 
-    //AND
-    else if(funct == 0b100100 && shamt == 0){
+    return MIPS_OK;
+}
 
-        uint32_t result = registers.read_reg(rs) & registers.read_reg(rt);
+//AND
+static mips_status op_and(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        registers.write_reg(rd, result);
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
 
-        registers.next_instruction_normal();
+    uint32_t result = registers.read_reg(rs) & registers.read_reg(rt);
+
+    registers.write_reg(rd, result);
+
+    registers.next_instruction_normal();
+
+    return MIPS_OK;
+}
+
+//DIV
+static mips_status op_div(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
+
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+
+    //convert the register values to signed
+    int32_t a = registers.read_reg(rs);
+    int32_t b = registers.read_reg(rt);
+
+    if(b != 0){
+
+        int32_t quotient = a / b;
+        int32_t remainder = a % b;
+
+        registers.write_hi(remainder);
+        registers.write_lo(quotient);
     }
 
-    //DIV
-    else if(funct == 0b011010 && rd == 0 && shamt == 0){
+    registers.next_instruction_normal();
 
-        //convert the register values to signed
-        int32_t a = registers.read_reg(rs);
-        int32_t b = registers.read_reg(rt);
+    return MIPS_OK;
+}
 
-        if(b != 0){
+//DIVU
+static mips_status op_divu(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-            int32_t quotient = a / b;
-            int32_t remainder = a % b;
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
 
-            registers.write_hi(remainder);
-            registers.write_lo(quotient);
-        }
+    //convert the register values to signed
+    uint32_t a = registers.read_reg(rs);
+    uint32_t b = registers.read_reg(rt);
 
-        registers.next_instruction_normal();
+    if(b != 0){
+
+        uint32_t quotient = a / b;
+        uint32_t remainder = a % b;
+
+        registers.write_hi(remainder);
+        registers.write_lo(quotient);
     }
 
-    //DIVU
-    else if(funct == 0b011011 && rd == 0 && shamt == 0){
+    registers.next_instruction_normal();
 
-        //convert the register values to signed
-        uint32_t a = registers.read_reg(rs);
-        uint32_t b = registers.read_reg(rt);
+    return MIPS_OK;
+}
 
-        if(b != 0){
+//JALR
+static mips_status op_jalr(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-            uint32_t quotient = a / b;
-            uint32_t remainder = a % b;
+    uint8_t rs = instr.rs;
+    uint8_t rd = instr.rd;
 
-            registers.write_hi(remainder);
-            registers.write_lo(quotient);
-        }
+    uint32_t destination_address = registers.read_reg(rs);
 
-        registers.next_instruction_normal();
+    registers.write_reg(rd, registers.read_pc() + 8);
+
+    if(destination_address % 4 == 0){
+
+        //the delay slot runs next, then the PC goes to the target
+        return branch_to(destination_address, registers);
     }
+    else{
 
-    //JALR
-    else if(funct == 0b001001 && rt == 0 && shamt == 0){
+        return MIPS_MEMORY_TRAP;
+    }
 
-        // std::cerr << "entered JALR" << std::endl;
+    return MIPS_OK;
+}
 
-        uint32_t destination_address = registers.read_reg(rs);
+//MFHI
+static mips_status op_mfhi(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        registers.write_reg(rd, registers.read_pc() + 8);
+    uint8_t rd = instr.rd;
 
-        if(destination_address % 4 == 0){
+    registers.write_reg(rd, registers.read_hi());
 
-            //branch delay
-            if(registers.read_pc() < memory.read_LAST_INSTR_ADDRESS()){ //only executes the branch delay instruction if it there is an instruction after
+    registers.next_instruction_normal();
 
-                // std::cerr << "entered Branch Delay in JALR" << std::endl;
+    return MIPS_OK;
+}
 
-                instruction_decode_run(memory.read_INSTR(registers.read_pc()+4), memory, registers);
-            }   
+//MFLO
+static mips_status op_mflo(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-            //if the address points at 0x0, which means the program has finished execution, exit and indicate success
-            if(destination_address == 0){
+    uint8_t rd = instr.rd;
 
-                uint8_t exit_code = registers.read_reg(2);
+    registers.write_reg(rd, registers.read_lo());
 
-                exit(exit_code);
-            }
+    registers.next_instruction_normal();
 
-            //if the address is out of bounds, exit and indicate memory error
-            else if(destination_address < 0x10000000 || destination_address >= 0x11000000){
-               
-                exit(-11);
-            }
+    return MIPS_OK;
+}
 
-            registers.next_instruction_branch(destination_address);
-        }
-        else{
+//MTHI
+static mips_status op_mthi(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-            exit(-11);
-        }
-    }
+    uint8_t rs = instr.rs;
 
-    //MFHI
-    else if(funct == 0b010000 && rs == 0 && rt == 0 && shamt == 0){
+    registers.write_hi(registers.read_reg(rs));
 
-        registers.write_reg(rd, registers.read_hi());
+    registers.next_instruction_normal();
 
-        registers.next_instruction_normal();
-    }
+    return MIPS_OK;
+}
 
-    //MFLO
-    else if(funct == 0b010010 && rs == 0 && rt == 0 && shamt == 0){
+//MTLO
+static mips_status op_mtlo(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        registers.write_reg(rd, registers.read_lo());
+    uint8_t rs = instr.rs;
 
-        registers.next_instruction_normal();
-    }
+    registers.write_lo(registers.read_reg(rs));
 
-    //MTHI
-    else if(funct == 0b010001 && rt == 0 && rd == 0 && shamt == 0){
+    registers.next_instruction_normal();
 
-        registers.write_hi(registers.read_reg(rs));
+    return MIPS_OK;
+}
 
-        registers.next_instruction_normal();
-    }
+//MULT
+static mips_status op_mult(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-    //MTLO
-    else if(funct == 0b010011 && rt == 0 && rd == 0 && shamt == 0){
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
 
-        registers.write_lo(registers.read_reg(rs));
+    int64_t result;
 
-        registers.next_instruction_normal();
-    }
+    //make the registers signed
+    int32_t a = registers.read_reg(rs);
+    int32_t b = registers.read_reg(rt);
 
-    //MULT
-    else if(funct == 0b011000 && rd == 0 && shamt == 0){
+    //sign extending them to 64 bits
+    int64_t a_ext = a;
+    int64_t b_ext = b;
 
-        // std::cerr << "entered MULT" << std::endl;
+    
 
-        int64_t result;
+    result = a_ext * b_ext;
 
-        //make the registers signed
-        int32_t a = registers.read_reg(rs);
-        int32_t b = registers.read_reg(rt);
+    registers.write_lo(result & 0xFFFFFFFF);
+    registers.write_hi((result >> 32) & 0xFFFFFFFF);
 
-        //sign extending them to 64 bits
-        int64_t a_ext = a;
-        int64_t b_ext = b;
+    registers.next_instruction_normal();
 
-        
+    return MIPS_OK;
+}
 
-        result = a_ext * b_ext;
+//MULTU
+static mips_status op_multu(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        // std::cerr << "rs content: " << a << " rt content: " << b << "result: " << result << std::endl;
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
 
-        registers.write_lo(result & 0xFFFFFFFF);
-        registers.write_hi((result >> 32) & 0xFFFFFFFF);
+    uint64_t result;
 
-        // std::cerr << "hi: " << registers.read_hi() << " lo: " << registers.read_lo() << std::endl;
-        registers.next_instruction_normal();
-    }
+    uint64_t a_ext = registers.read_reg(rs);
+    uint64_t b_ext = registers.read_reg(rt);
 
-    //MULTU
-    else if(funct == 0b011001 && rd == 0 && shamt == 0){
+    result = a_ext * b_ext;
 
-        uint64_t result;
+    registers.write_lo(result & 0xFFFFFFFF);
+    registers.write_hi((result >> 32) & 0xFFFFFFFF);
 
-        uint64_t a_ext = registers.read_reg(rs);
-        uint64_t b_ext = registers.read_reg(rt);
+    registers.next_instruction_normal();
 
-        result = a_ext * b_ext;
+    return MIPS_OK;
+}
 
-        registers.write_lo(result & 0xFFFFFFFF);
-        registers.write_hi((result >> 32) & 0xFFFFFFFF);
+//OR
+static mips_status op_or(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        registers.next_instruction_normal();
-    }
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
 
-    //OR
-    else if(funct == 0b100101 && shamt == 0){
-        registers.write_reg(rd, registers.read_reg(rs) | registers.read_reg(rt));
+    registers.write_reg(rd, registers.read_reg(rs) | registers.read_reg(rt));
 
-        registers.next_instruction_normal();
-    }
+    registers.next_instruction_normal();
 
-    //SLL
-    else if(funct == 0b000000 && rs == 0){
-        
-        registers.write_reg(rd, registers.read_reg(rt) << shamt);
+    return MIPS_OK;
+}
 
-        registers.next_instruction_normal();
-    }
+//SLL
+static mips_status op_sll(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-    //SLLV
-    else if(funct == 0b000100 && shamt == 0){
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
+    uint8_t shamt = instr.immediate;
 
-        registers.write_reg(rd, registers.read_reg(rt) << (registers.read_reg(rs) & 0x1F));
+    
+    registers.write_reg(rd, registers.read_reg(rt) << shamt);
 
-        registers.next_instruction_normal();
-    }
+    registers.next_instruction_normal();
 
-    //SLT
-    else if(funct == 0b101010 && shamt == 0){
+    return MIPS_OK;
+}
 
-        int32_t rs_signed = registers.read_reg(rs);
-        int32_t rt_signed = registers.read_reg(rt);
+//SLLV
+static mips_status op_sllv(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        if(rs_signed < rt_signed){
-            registers.write_reg(rd,1);
-        }
-        else{
-            registers.write_reg(rd,0);
-        }
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
 
-        registers.next_instruction_normal();
-    }
+    registers.write_reg(rd, registers.read_reg(rt) << (registers.read_reg(rs) & 0x1F));
 
-    //SLTU
-    else if(funct == 0b101011 && shamt == 0){
+    registers.next_instruction_normal();
 
-        if(registers.read_reg(rs) < registers.read_reg(rt)){
+    return MIPS_OK;
+}
 
-            registers.write_reg(rd, 1);
-        }
-        else{
+//SLT
+static mips_status op_slt(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-            registers.write_reg(rd, 0);
-        }
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
 
-        registers.next_instruction_normal();
+    int32_t rs_signed = registers.read_reg(rs);
+    int32_t rt_signed = registers.read_reg(rt);
+
+    if(rs_signed < rt_signed){
+        registers.write_reg(rd,1);
     }
+    else{
+        registers.write_reg(rd,0);
+    }
+
+    registers.next_instruction_normal();
 
-    //SRA
-    else if(funct == 0b000011 && rs == 0){
+    return MIPS_OK;
+}
 
-        //convert to signed
-        int32_t rt_signed = registers.read_reg(rt);
+//SLTU
+static mips_status op_sltu(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        registers.write_reg(rd, rt_signed >> shamt);
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
 
-        registers.next_instruction_normal();
+    if(registers.read_reg(rs) < registers.read_reg(rt)){
+
+        registers.write_reg(rd, 1);
     }
+    else{
 
-    //SRAV
-    else if(funct == 0b000111 && shamt == 0){
+        registers.write_reg(rd, 0);
+    }
 
-        //convert to signed
-        int32_t rt_signed = registers.read_reg(rt);
+    registers.next_instruction_normal();
 
-        registers.write_reg(rd, rt_signed >> (registers.read_reg(rs) & 0x1F));
+    return MIPS_OK;
+}
 
-        registers.next_instruction_normal();
-    }
+//SRA
+static mips_status op_sra(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-    //SRL
-    else if(funct == 0b000010 && rs == 0){
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
+    uint8_t shamt = instr.immediate;
 
-        registers.write_reg(rd, registers.read_reg(rt) >> shamt);
+    //convert to signed
+    int32_t rt_signed = registers.read_reg(rt);
 
-        registers.next_instruction_normal();
-    }
+    registers.write_reg(rd, rt_signed >> shamt);
 
-    //SRLV
-    else if(funct == 0b000110 && shamt == 0){
+    registers.next_instruction_normal();
 
-        registers.write_reg(rd, registers.read_reg(rt) >> (registers.read_reg(rs) & 0x1F));
+    return MIPS_OK;
+}
 
-        registers.next_instruction_normal();
-    }
+//SRAV
+static mips_status op_srav(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-    //SUB
-    else if(funct == 0b100010 && shamt == 0){
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
 
-        int32_t a = registers.read_reg(rs);
-        int32_t b = registers.read_reg(rt);
+    //convert to signed
+    int32_t rt_signed = registers.read_reg(rt);
 
-        int32_t result = a - b;
+    registers.write_reg(rd, rt_signed >> (registers.read_reg(rs) & 0x1F));
 
-        if((((a & 0x80000000) == 0) && ((b & 0x80000000) != 0) && ((result & 0x80000000) != 0)) || (((a & 0x80000000) != 0) && ((b & 0x80000000) == 0) && ((result & 0x80000000) == 0))){
+    registers.next_instruction_normal();
 
-            exit(-10);
-        }
-        
-        registers.write_reg(rd, result);
+    return MIPS_OK;
+}
 
-        registers.next_instruction_normal();
-    }
+//SRL
+static mips_status op_srl(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-    //SUBU
-    else if(funct == 0b100011 && shamt == 0){
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
+    uint8_t shamt = instr.immediate;
 
-        registers.write_reg(rd, registers.read_reg(rs) - registers.read_reg(rt));
+    registers.write_reg(rd, registers.read_reg(rt) >> shamt);
 
-        registers.next_instruction_normal();
-    }
+    registers.next_instruction_normal();
 
-    //XOR
-    else if(funct == 0b100110 && shamt == 0){
+    return MIPS_OK;
+}
 
-        registers.write_reg(rd, registers.read_reg(rs) ^ registers.read_reg(rt));
+//SRLV
+static mips_status op_srlv(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        registers.next_instruction_normal();
-    }
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
 
+    registers.write_reg(rd, registers.read_reg(rt) >> (registers.read_reg(rs) & 0x1F));
 
-    else{
+    registers.next_instruction_normal();
 
-        // std::cerr << "not a valid R type instruction" << std::endl;
-        //not a valid instruction (for now it might also not be implemented yet)
-        exit(-12);
-    }
+    return MIPS_OK;
 }
 
-void itype(uint8_t opcode, uint8_t rs, uint8_t rt, uint16_t immediate, mips_memory& memory, mips_registers& registers){
+//SUB
+static mips_status op_sub(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-    //LUI
-    if(opcode == 0b001111 && rs == 0){
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
 
-        // std::cerr << "entered LUI" << std::endl;
+    int32_t a = registers.read_reg(rs);
+    int32_t b = registers.read_reg(rt);
 
-        uint32_t temp = immediate << 16; 
+    int32_t result = (uint32_t)a - (uint32_t)b;
 
-        registers.write_reg(rt,temp);
+    if((((a & 0x80000000) == 0) && ((b & 0x80000000) != 0) && ((result & 0x80000000) != 0)) || (((a & 0x80000000) != 0) && ((b & 0x80000000) == 0) && ((result & 0x80000000) == 0))){
 
-        registers.next_instruction_normal();
+        return MIPS_ARITHMETIC_TRAP;
     }
+    
+    registers.write_reg(rd, result);
 
-    //ADDIU
-    else if(opcode == 0b001001){
-        
-        // std::cerr << "entered ADDIU" << std::endl;
-        //sign extend the immediate. The current immediate is uint16_t, so i first have to convert it into a signed 16bit type, and then into a 32bit to sign extend properly
-        int16_t signed_immediate = immediate;
-        int32_t sign_extended_immediate = signed_immediate;
+    registers.next_instruction_normal();
 
-        // std::cerr << "signed_extended_value: " << std::hex << sign_extended_immediate << std::endl;
+    return MIPS_OK;
+}
 
-        //do the calculation
-        int sum = registers.read_reg(rs) + sign_extended_immediate;
+//SUBU
+static mips_status op_subu(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        // std::cerr << "sum: " << sum << std::endl;
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
 
-        registers.write_reg(rt, sum);
+    registers.write_reg(rd, registers.read_reg(rs) - registers.read_reg(rt));
 
-        // std::cerr << "contents of rt: " << registers.read_reg(rt) << std::endl;
+    registers.next_instruction_normal();
 
-        registers.next_instruction_normal();
-    }
+    return MIPS_OK;
+}
 
-    //SW
-    else if(opcode == 0b101011){
-        
-        // std::cerr << "entered SW" << std::endl;
+//XOR
+static mips_status op_xor(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
+
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
 
-        //sign extend the immediate
-        int16_t signed_immediate = immediate;
-        int32_t sign_extended_immediate = signed_immediate;
+    registers.write_reg(rd, registers.read_reg(rs) ^ registers.read_reg(rt));
+
+    registers.next_instruction_normal();
+
+    return MIPS_OK;
+}
 
-        //work out the address
-        uint32_t address = registers.read_reg(rs) + sign_extended_immediate;
+//LUI
+static mips_status op_lui(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        // std::cerr << "SW address: " << std::hex << address << std::endl;
-        // std::cerr << "contents of rt: " << registers.read_reg(rt) << std::endl;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
+
+    //the immediate was shifted into the upper half when decoding
+    registers.write_reg(rt, immediate);
+
+    registers.next_instruction_normal();
+
+    return MIPS_OK;
+}
+
+//ADDIU
+static mips_status op_addiu(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
+
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-        //exceptions
     
-        //write the contents of register rt to memory
-        memory.write_DATA(registers.read_reg(rt), address);
+    //the immediate was already sign extended when the instruction was decoded
+    int32_t sign_extended_immediate = immediate;
 
-        registers.next_instruction_normal();
-    }
+    //do the calculation
+    int sum = registers.read_reg(rs) + sign_extended_immediate;
+
+    registers.write_reg(rt, sum);
 
-    //LW
-    else if(opcode == 0b100011){
+    registers.next_instruction_normal();
 
-        // std::cerr << "entered LW" << std::endl;
+    return MIPS_OK;
+}
 
-        //sign extend the immediate
-        int16_t signed_immediate = immediate;
-        int32_t sign_extended_immediate = signed_immediate;
+//SW
+template<class access>
+static mips_status op_sw(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory& memory, mips_registers& registers){
 
-        //work out the address
-        uint32_t address = registers.read_reg(rs) + sign_extended_immediate;
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-        // std::cerr << "address is " << std::hex << address << std::endl;
-  
-        uint32_t data = memory.read_DATA(address);
-        registers.write_reg(rt, data);
-        
-        registers.next_instruction_normal();
+    
+    //the immediate is already sign extended
+    int32_t sign_extended_immediate = immediate;
+
+    //work out the address
+    uint32_t address = registers.read_reg(rs) + sign_extended_immediate;
+
+    //exceptions
+
+    //write the contents of register rt to memory
+    mips_status status = access::write_DATA(memory, registers.read_reg(rt), address);
+
+    if(status != MIPS_OK){
+        return status;
     }
 
-    //ORI
-    else if(opcode == 0b001101){
+    registers.next_instruction_normal();
 
-        // std::cerr << "entered ORI" << std::endl;
+    return MIPS_OK;
+}
 
-        //zero extend the immeditate to 32bit
-        uint32_t zero_extended_immediate = immediate;
-        
-        //do the calculation:
-        uint32_t result = zero_extended_immediate | registers.read_reg(rs);
+//LW
+template<class access>
+static mips_status op_lw(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory& memory, mips_registers& registers){
 
-        registers.write_reg(rt, result);
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-        registers.next_instruction_normal();
+    //the immediate is already sign extended
+    int32_t sign_extended_immediate = immediate;
+
+    //work out the address
+    uint32_t address = registers.read_reg(rs) + sign_extended_immediate;
+
+    uint32_t data;
+    mips_status status = access::read_DATA(memory, address, data);
+
+    if(status != MIPS_OK){
+        return status;
     }
+    registers.write_reg(rt, data);
+    
+    registers.next_instruction_normal();
 
-    //BNE
-    else if(opcode == 0b000101){
+    return MIPS_OK;
+}
 
-        // std::cerr << "entered BNE" << std::endl;
+//ORI
+static mips_status op_ori(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        
-        int16_t shifted_offset = immediate;
-        int32_t offset = shifted_offset << 2;
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-        uint32_t address = registers.read_pc() + offset + 4;
+    //the immeditate was zero extended to 32bit when decoding
+    uint32_t zero_extended_immediate = immediate;
+    
+    //do the calculation:
+    uint32_t result = zero_extended_immediate | registers.read_reg(rs);
 
-        if(registers.read_reg(rs) != registers.read_reg(rt)){
+    registers.write_reg(rt, result);
 
-            //branch delay
-            if(registers.read_pc() < memory.read_LAST_INSTR_ADDRESS()){ //only executes the branch delay instruction if it there is an instruction after the JR
+    registers.next_instruction_normal();
 
-                instruction_decode_run(memory.read_INSTR(registers.read_pc()+4), memory, registers);
-            }   
+    return MIPS_OK;
+}
 
-            //if the address points at 0x0, which means the program has finished execution, exit and indicate success
-            if(address == 0){
+//BNE
+static mips_status op_bne(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-                uint8_t exit_code = registers.read_reg(2);
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-                exit(exit_code);
-            }
+    
+    //the immediate already holds the offset from the PC to the target
+    uint32_t address = registers.read_pc() + immediate;
 
-            //if the address is out of bounds, exit and indicate memory error
-            else if(address < 0x10000000 || address >= 0x11000000){
-               
-                exit(-11);
-            }
+    if(registers.read_reg(rs) != registers.read_reg(rt)){
 
-            registers.next_instruction_branch(address);
-        }
-        else{
-            registers.next_instruction_normal();
-        }
+        //the delay slot runs next, then the PC goes to the target
+        return branch_to(address, registers);
+    }
+    else{
+        registers.next_instruction_normal();
     }
 
-    //ADDI
-    else if(opcode == 0b001000){
-        
-        // std::cerr << "entered ADDI" << std::endl;
+    return MIPS_OK;
+}
 
-        //sign extend the immediate
-        int16_t signed_immediate = immediate;
-        int32_t sign_extended_immediate = signed_immediate;
+//ADDI
+static mips_status op_addi(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        int32_t a = registers.read_reg(rs);
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-        int32_t sum = a + sign_extended_immediate;
+    
+    //the immediate is already sign extended
+    int32_t sign_extended_immediate = immediate;
 
-        //checking for 2s complement overflow
-        if((a > 0 && sign_extended_immediate > 0 && sum < 0) || (a < 0 && sign_extended_immediate < 0 && sum > 0)){ //overflow detected
+    int32_t a = registers.read_reg(rs);
 
-            exit(-10);
-        }
-        else{
+    int32_t sum = (uint32_t)a + (uint32_t)sign_extended_immediate;
 
-            registers.write_reg(rt, sum);
-            
-            registers.next_instruction_normal();
-        }
+    //checking for 2s complement overflow
+    if((a > 0 && sign_extended_immediate > 0 && sum < 0) || (a < 0 && sign_extended_immediate < 0 && sum > 0)){ //overflow detected
+
+        return MIPS_ARITHMETIC_TRAP;
     }
+    else{
 
-    //ANDI
-    else if(opcode == 0b001100){
+        registers.write_reg(rt, sum);
         
-        uint32_t result = registers.read_reg(rs) & immediate;
-
-        registers.write_reg(rt, result);
-
         registers.next_instruction_normal();
     }
 
-    //BEQ
-    else if(opcode == 0b000100){
+    return MIPS_OK;
+}
 
-        // std::cerr << "entered BEQ" << std::endl;
+//ANDI
+static mips_status op_andi(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        
-        int16_t shifted_offset = immediate;
-        int32_t offset = shifted_offset << 2;
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-        uint32_t address = registers.read_pc() + offset + 4;
+    
+    uint32_t result = registers.read_reg(rs) & immediate;
 
-        if(registers.read_reg(rs) == registers.read_reg(rt)){
+    registers.write_reg(rt, result);
 
-            //branch delay
-            if(registers.read_pc() < memory.read_LAST_INSTR_ADDRESS()){ //only executes the branch delay instruction if it there is an instruction after the JR
+    registers.next_instruction_normal();
 
-                instruction_decode_run(memory.read_INSTR(registers.read_pc()+4), memory, registers);
-            }   
+    return MIPS_OK;
+}
 
-            //if the address points at 0x0, which means the program has finished execution, exit and indicate success
-            if(address == 0){
+//BEQ
+static mips_status op_beq(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-                uint8_t exit_code = registers.read_reg(2);
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-                exit(exit_code);
-            }
+    
+    //the immediate already holds the offset from the PC to the target
+    uint32_t address = registers.read_pc() + immediate;
 
-            //if the address is out of bounds, exit and indicate memory error
-            else if(address < 0x10000000 || address >= 0x11000000){
-               
-                exit(-11);
-            }
+    if(registers.read_reg(rs) == registers.read_reg(rt)){
 
-            registers.next_instruction_branch(address);
-        }
-        else{
-            registers.next_instruction_normal();
-        }
+        //the delay slot runs next, then the PC goes to the target
+        return branch_to(address, registers);
+    }
+    else{
+        registers.next_instruction_normal();
     }
 
-    //BGEZ
-    else if(opcode == 0b000001 && rt == 0b00001){
+    return MIPS_OK;
+}
 
-        // std::cerr << "entered BGEZ" << std::endl;
+//BGEZ
+static mips_status op_bgez(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        
-        int16_t shifted_offset = immediate;
-        int32_t offset = shifted_offset << 2;
+    uint8_t rs = instr.rs;
+    uint32_t immediate = instr.immediate;
 
-        uint32_t address = registers.read_pc() + offset + 4;
+    
+    //the immediate already holds the offset from the PC to the target
+    uint32_t address = registers.read_pc() + immediate;
+
+    if((registers.read_reg(rs) & 0x80000000) == 0){ //check msb (as i store the registers as unsigned ints)
 
-        if((registers.read_reg(rs) & 0x80000000) == 0){ //check msb (as i store the registers as unsigned ints)
+        //the delay slot runs next, then the PC goes to the target
+        return branch_to(address, registers);
+    }
+    else{
+        registers.next_instruction_normal();
+    }
 
-            //branch delay
-            if(registers.read_pc() < memory.read_LAST_INSTR_ADDRESS()){ //only executes the branch delay instruction if it there is an instruction after the JR
+    return MIPS_OK;
+}
 
-                instruction_decode_run(memory.read_INSTR(registers.read_pc()+4), memory, registers);
-            }   
+//BGEZAL
+static mips_status op_bgezal(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-            //if the address points at 0x0, which means the program has finished execution, exit and indicate success
-            if(address == 0){
+    uint8_t rs = instr.rs;
+    uint32_t immediate = instr.immediate;
 
-                uint8_t exit_code = registers.read_reg(2);
+    //the immediate already holds the offset from the PC to the target
+    uint32_t address = registers.read_pc() + immediate;
 
-                exit(exit_code);
-            }
+    registers.write_reg(31, registers.read_pc()+8);
 
-            //if the address is out of bounds, exit and indicate memory error
-            else if(address < 0x10000000 || address >= 0x11000000){
-               
-                exit(-11);
-            }
+    if((registers.read_reg(rs) & 0x80000000) == 0){ //check msb (as i store the registers as unsigned ints)
 
-            registers.next_instruction_branch(address);
-        }
-        else{
-            registers.next_instruction_normal();
-        }
+        //the delay slot runs next, then the PC goes to the target
+        return branch_to(address, registers);
     }
 
-    //BGEZAL
-    else if(opcode == 0b000001 && rt == 0b10001){
+    else{
 
-        // std::cerr << "entered BGEZAL" << std::endl;
+        registers.next_instruction_normal();
+    }
 
-        int16_t shifted_offset = immediate;
-        int32_t offset = shifted_offset << 2;
+    return MIPS_OK;
+}
 
-        uint32_t address = registers.read_pc() + offset + 4;
+//BGTZ
+static mips_status op_bgtz(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        registers.write_reg(31, registers.read_pc()+8);
+    uint8_t rs = instr.rs;
+    uint32_t immediate = instr.immediate;
 
-        if((registers.read_reg(rs) & 0x80000000) == 0){ //check msb (as i store the registers as unsigned ints)
+    //the immediate already holds the offset from the PC to the target
+    uint32_t address = registers.read_pc() + immediate;
 
-            //branch delay
-            if(registers.read_pc() < memory.read_LAST_INSTR_ADDRESS()){ //only executes the branch delay instruction if it there is an instruction after the JR
+    if(((registers.read_reg(rs) & 0x80000000) == 0) && ((registers.read_reg(rs) != 0))){ //check msb (as i store the registers as unsigned ints)
 
-                instruction_decode_run(memory.read_INSTR(registers.read_pc()+4), memory, registers);
-            }   
+        //the delay slot runs next, then the PC goes to the target
+        return branch_to(address, registers);
+    }
+    else{
+        registers.next_instruction_normal();
+    }
 
-            //if the address points at 0x0, which means the program has finished execution, exit and indicate success
-            if(address == 0){
+    return MIPS_OK;
+}
 
-                uint8_t exit_code = registers.read_reg(2);
+//BLEZ
+static mips_status op_blez(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-                exit(exit_code);
-            }
+    uint8_t rs = instr.rs;
+    uint32_t immediate = instr.immediate;
 
-            //if the address is out of bounds, exit and indicate memory error
-            else if(address < 0x10000000 || address >= 0x11000000){
-               
-                exit(-11);
-            }
+    
+    //the immediate already holds the offset from the PC to the target
+    uint32_t address = registers.read_pc() + immediate;
 
-            registers.next_instruction_branch(address);
-        }
 
-        else{
+    if(((registers.read_reg(rs) & 0x80000000) != 0) || ((registers.read_reg(rs) == 0))){ //check msb (as i store the registers as unsigned ints)
 
-            registers.next_instruction_normal();
-        }
+        //the delay slot runs next, then the PC goes to the target
+        return branch_to(address, registers);
+    }
+    else{
+        registers.next_instruction_normal();
     }
 
-    //BGTZ
-    else if(opcode == 0b000111 && rt == 0b00000){
+    return MIPS_OK;
+}
 
-        // std::cerr << "entered BGTZ" << std::endl;
+//BLTZ
+static mips_status op_bltz(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        int16_t shifted_offset = immediate;
-        int32_t offset = shifted_offset << 2;
+    uint8_t rs = instr.rs;
+    uint32_t immediate = instr.immediate;
 
-        uint32_t address = registers.read_pc() + offset + 4;
+    //the immediate already holds the offset from the PC to the target
+    uint32_t address = registers.read_pc() + immediate;
 
-        if(((registers.read_reg(rs) & 0x80000000) == 0) && ((registers.read_reg(rs) != 0))){ //check msb (as i store the registers as unsigned ints)
+    if((registers.read_reg(rs) & 0x80000000) != 0){ //check msb (as i store the registers as unsigned ints)
 
-            //branch delay
-            if(registers.read_pc() < memory.read_LAST_INSTR_ADDRESS()){ //only executes the branch delay instruction if it there is an instruction after the JR
+        //the delay slot runs next, then the PC goes to the target
+        return branch_to(address, registers);
+    }
+    else{
+        registers.next_instruction_normal();
+    }
 
-                instruction_decode_run(memory.read_INSTR(registers.read_pc()+4), memory, registers);
-            }   
+    return MIPS_OK;
+}
 
-            //if the address points at 0x0, which means the program has finished execution, exit and indicate success
-            if(address == 0){
+//BLTZAL
+static mips_status op_bltzal(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-                uint8_t exit_code = registers.read_reg(2);
+    uint8_t rs = instr.rs;
+    uint32_t immediate = instr.immediate;
 
-                exit(exit_code);
-            }
+    //the immediate already holds the offset from the PC to the target
+    uint32_t address = registers.read_pc() + immediate;
 
-            //if the address is out of bounds, exit and indicate memory error
-            else if(address < 0x10000000 || address >= 0x11000000){
-               
-                exit(-11);
-            }
+    registers.write_reg(31, registers.read_pc()+8);
 
-            registers.next_instruction_branch(address);
-        }
-        else{
-            registers.next_instruction_normal();
-        }
+    if((registers.read_reg(rs) & 0x80000000) != 0){ //check msb (as i store the registers as unsigned ints)
+
+        //the delay slot runs next, then the PC goes to the target
+        return branch_to(address, registers);
     }
 
-    //BLEZ
-    else if(opcode == 0b000110 && rt == 0b00000){
+    else{
 
-        // std::cerr << "entered BLEZ" << std::endl;
+        registers.next_instruction_normal();
+    }
 
-        
-        int16_t shifted_offset = immediate;
-        int32_t offset = shifted_offset << 2;
+    return MIPS_OK;
+}
 
-        uint32_t address = registers.read_pc() + offset + 4;
+//LB
+template<class access>
+static mips_status op_lb(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory& memory, mips_registers& registers){
 
-        // std::cerr << "contents of register rs " << std::hex << registers.read_reg(rs) << std::endl;
-        
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-        if(((registers.read_reg(rs) & 0x80000000) != 0) || ((registers.read_reg(rs) == 0))){ //check msb (as i store the registers as unsigned ints)
+    //the immediate is already sign extended
+    int32_t extended_signed_immediate = immediate;
 
-            //branch delay
-            if(registers.read_pc() < memory.read_LAST_INSTR_ADDRESS()){ //only executes the branch delay instruction if it there is an instruction after the JR
+    uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
 
-                instruction_decode_run(memory.read_INSTR(registers.read_pc()+4), memory, registers);
-            }   
+    uint8_t byte;
+    mips_status status = access::read_BYTE(memory, address, byte);
 
-            //if the address points at 0x0, which means the program has finished execution, exit and indicate success
-            if(address == 0){
+    if(status != MIPS_OK){
+        return status;
+    }
 
-                uint8_t exit_code = registers.read_reg(2);
+    int32_t sign_extended_word = (int8_t)byte;
+    registers.write_reg(rt, sign_extended_word);
 
-                exit(exit_code);
-            }
+    registers.next_instruction_normal();
 
-            //if the address is out of bounds, exit and indicate memory error
-            else if(address < 0x10000000 || address >= 0x11000000){
-               
-                exit(-11);
-            }
+    return MIPS_OK;
+}
 
-            registers.next_instruction_branch(address);
-        }
-        else{
-            registers.next_instruction_normal();
-        }
-    }
+//LBU
+template<class access>
+static mips_status op_lbu(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory& memory, mips_registers& registers){
 
-    //BLTZ
-    else if(opcode == 0b000001 && rt == 0b00000){
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-        // std::cerr << "entered BLTZ" << std::endl;
-        
-        int16_t shifted_offset = immediate;
-        int32_t offset = shifted_offset << 2;
+    //the immediate is already sign extended
+    int32_t extended_signed_immediate = immediate;
+
+    uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
 
-        uint32_t address = registers.read_pc() + offset + 4;
+    uint8_t byte;
+    mips_status status = access::read_BYTE(memory, address, byte);
 
-        if((registers.read_reg(rs) & 0x80000000) != 0){ //check msb (as i store the registers as unsigned ints)
+    if(status != MIPS_OK){
+        return status;
+    }
 
-            //branch delay
-            if(registers.read_pc() < memory.read_LAST_INSTR_ADDRESS()){ //only executes the branch delay instruction if it there is an instruction after the JR
+    uint32_t zero_extended_word = byte;
+    registers.write_reg(rt, zero_extended_word);
 
-                instruction_decode_run(memory.read_INSTR(registers.read_pc()+4), memory, registers);
-            }   
+    registers.next_instruction_normal();
 
-            //if the address points at 0x0, which means the program has finished execution, exit and indicate success
-            if(address == 0){
+    return MIPS_OK;
+}
 
-                uint8_t exit_code = registers.read_reg(2);
+//LH
+template<class access>
+static mips_status op_lh(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory& memory, mips_registers& registers){
 
-                exit(exit_code);
-            }
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-            //if the address is out of bounds, exit and indicate memory error
-            else if(address < 0x10000000 || address >= 0x11000000){
-               
-                exit(-11);
-            }
+    //the immediate is already sign extended
+    int32_t extended_signed_immediate = immediate;
 
-            registers.next_instruction_branch(address);
-        }
-        else{
-            registers.next_instruction_normal();
-        }
+    uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
+
+    uint16_t hword;
+    mips_status status = access::read_HALF(memory, address, hword); //traps if it isn't alligned
+
+    if(status != MIPS_OK){
+        return status;
     }
 
-    //BLTZAL
-    else if(opcode == 0b000001 && rt == 0b10000){
+    int32_t signed_extension_hword = (int16_t)hword;
 
-        // std::cerr << "entered BLTZAL" << std::endl;
+    registers.write_reg(rt, signed_extension_hword);
 
-        int16_t shifted_offset = immediate;
-        int32_t offset = shifted_offset << 2;
+    registers.next_instruction_normal();
 
-        uint32_t address = registers.read_pc() + offset + 4;
+    return MIPS_OK;
+}
 
-        registers.write_reg(31, registers.read_pc()+8);
+//LHU
+template<class access>
+static mips_status op_lhu(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory& memory, mips_registers& registers){
 
-        if((registers.read_reg(rs) & 0x80000000) != 0){ //check msb (as i store the registers as unsigned ints)
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-            //branch delay
-            if(registers.read_pc() < memory.read_LAST_INSTR_ADDRESS()){ //only executes the branch delay instruction if it there is an instruction after the JR
+    //the immediate is already sign extended
+    int32_t extended_signed_immediate = immediate;
 
-                instruction_decode_run(memory.read_INSTR(registers.read_pc()+4), memory, registers);
-            }   
+    uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
 
-            //if the address points at 0x0, which means the program has finished execution, exit and indicate success
-            if(address == 0){
+    uint16_t hword;
+    mips_status status = access::read_HALF(memory, address, hword); //traps if it isn't alligned
 
-                uint8_t exit_code = registers.read_reg(2);
+    if(status != MIPS_OK){
+        return status;
+    }
 
-                exit(exit_code);
-            }
+    uint32_t zero_extension_hword = hword;
 
-            //if the address is out of bounds, exit and indicate memory error
-            else if(address < 0x10000000 || address >= 0x11000000){
-               
-                exit(-11);
-            }
+    registers.write_reg(rt, zero_extension_hword);
 
-            registers.next_instruction_branch(address);
-        }
+    registers.next_instruction_normal();
 
-        else{
+    return MIPS_OK;
+}
 
-            registers.next_instruction_normal();
-        }
-    }
+//LWL
+template<class access>
+static mips_status op_lwl(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory& memory, mips_registers& registers){
 
-    //LB
-    else if(opcode == 0b100000){
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-        //sign extend the immediate
-        int16_t signed_immediate = immediate;
-        int32_t extended_signed_immediate = signed_immediate;
+    //the immediate is already sign extended
+    int32_t extended_signed_immediate = immediate;
 
-        uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
+    uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
+    uint8_t offset = address % 4;
 
-        uint8_t offset = address % 4;
+    uint32_t original_word = registers.read_reg(rt);
+    uint32_t memory_word;
+    mips_status status = access::read_DATA(memory, address - offset, memory_word);
 
+    if(status != MIPS_OK){
+        return status;
+    }
 
-        uint32_t word = memory.read_DATA(address - offset);
-        int8_t byte;
+    if(offset == 1){
 
-        if(offset == 0){
-            word = word >> 24;
-        }
-        else if(offset == 1){
-            word = word >> 16;
-        }
-        else if(offset == 2){
-            word = word >> 8;
-        }
+        memory_word = (((memory_word << 8) & 0xFFFFFF00) | (original_word & 0xFF));
+    }
+    else if(offset == 2){
 
-        byte = word & 0xFF;
+        memory_word = (((memory_word << 16) & 0xFFFF0000) | (original_word & 0xFFFF));
+    }
 
-        int32_t sign_extended_word = byte;
-        registers.write_reg(rt, sign_extended_word);
+    else if(offset == 3){
 
-        registers.next_instruction_normal();
+        memory_word = (((memory_word << 24) & 0xFF000000) | (original_word & 0xFFFFFF));
     }
 
-    //LBU
-    else if(opcode == 0b100100){
+    //if offset is 0 no need to change anything
 
-        //sign extend the immediate
-        int16_t signed_immediate = immediate;
-        int32_t extended_signed_immediate = signed_immediate;
+    registers.write_reg(rt, memory_word);
 
-        uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
+    registers.next_instruction_normal();
 
-        uint8_t offset = address % 4;
+    return MIPS_OK;
+}
 
-        uint32_t word = memory.read_DATA(address - offset);
-        uint8_t byte;
+//LWR
+template<class access>
+static mips_status op_lwr(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory& memory, mips_registers& registers){
 
-        if(offset == 0){
-            word = word >> 24;
-        }
-        else if(offset == 1){
-            word = word >> 16;
-        }
-        else if(offset == 2){
-            word = word >> 8;
-        }
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-        byte = word & 0xFF;
+    //the immediate is already sign extended
+    int32_t extended_signed_immediate = immediate;
 
-        uint32_t sign_extended_word = byte;
-        registers.write_reg(rt, sign_extended_word);
+    uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
+    uint8_t offset = address % 4;
 
-        registers.next_instruction_normal();
-    }
+    uint32_t original_word = registers.read_reg(rt);
+    uint32_t memory_word;
+    mips_status status = access::read_DATA(memory, address - offset, memory_word);
 
-    //LH
-    else if(opcode == 0b100001){
+    if(status != MIPS_OK){
+        return status;
+    }
 
-        //sign extend the immediate
-        int16_t signed_immediate = immediate;
-        int32_t extended_signed_immediate = signed_immediate;
+    if(offset == 0){
 
-        uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
+        memory_word = (((memory_word >> 24 ) & 0xFF) | (original_word & 0xFFFFFF00));
+    }
+    else if(offset == 1){
 
-        uint8_t offset = address % 4;
+        memory_word = (((memory_word >> 16) & 0xFFFF) | (original_word & 0xFFFF0000));
+    }
 
-        int32_t word = memory.read_DATA(address - offset);
+    else if(offset == 2){
 
-        int16_t hword;
+        memory_word = (((memory_word >> 8) & 0xFFFFFF) | (original_word & 0xFF000000));
+    }
 
-        if(offset == 0){
+    //if offset is 3 no need to change anything
 
-            hword = (word >> 16);       
-        }
-        else if(offset == 2){
+    registers.write_reg(rt, memory_word);
 
-            hword = word;
-        }
-        else{
-            exit(-11);
-        }
+    registers.next_instruction_normal();
 
-        int32_t signed_extension_hword = hword;
+    return MIPS_OK;
+}
 
-        registers.write_reg(rt, signed_extension_hword);
+//SB
+template<class access>
+static mips_status op_sb(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory& memory, mips_registers& registers){
 
-        registers.next_instruction_normal();
-    }
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-    //LHU
-    else if(opcode == 0b100101){
+    //the immediate is already sign extended
+    int32_t extended_signed_immediate = immediate;
 
-        //sign extend the immediate
-        int16_t signed_immediate = immediate;
-        int32_t extended_signed_immediate = signed_immediate;
+    uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
 
-        uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
+    //only the bottom byte of rt is stored
+    mips_status status = access::write_BYTE(memory, registers.read_reg(rt) & 0xFF, address);
 
-        uint8_t offset = address % 4;
+    if(status != MIPS_OK){
+        return status;
+    }
 
-        uint32_t word = memory.read_DATA(address - offset);
+    registers.next_instruction_normal();
 
-        uint16_t hword;
+    return MIPS_OK;
+}
 
-        if(offset == 0){
+//SH
+template<class access>
+static mips_status op_sh(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory& memory, mips_registers& registers){
 
-            hword = (word >> 16);       
-        }
-        else if(offset == 2){
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-            hword = word;
-        }
-        else{
-            exit(-11);
-        }
+    //the immediate is already sign extended
+    int32_t extended_signed_immediate = immediate;
 
-        uint32_t zero_extension_hword = hword;
+    uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
 
-        registers.write_reg(rt, zero_extension_hword);
+    //only the bottom half of rt is stored, the address has to be alligned
+    mips_status status = access::write_HALF(memory, registers.read_reg(rt) & 0xFFFF, address);
 
-        registers.next_instruction_normal();
+    if(status != MIPS_OK){
+        return status;
     }
 
-    
-    //LWL
-    else if(opcode == 0b100010){
+    registers.next_instruction_normal();
 
-        //sign extend the immediate
-        int16_t signed_immediate = immediate;
-        int32_t extended_signed_immediate = signed_immediate;
+    return MIPS_OK;
+}
 
-        uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
-        uint8_t offset = address % 4;
+//SLTI
+static mips_status op_slti(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        uint32_t original_word = registers.read_reg(rt);
-        uint32_t memory_word = memory.read_DATA(address - offset);
-    
-        if(offset == 1){
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-            memory_word = (((memory_word << 8) & 0xFFFFFF00) | (original_word & 0xFF));
-        }
-        else if(offset == 2){
+    //make the contents of rs signed
+    int32_t signed_rs = registers.read_reg(rs);
 
-            memory_word = (((memory_word << 16) & 0xFFFF0000) | (original_word & 0xFFFF));
-        }
+    //the immediate is already sign extended
+    int32_t signed_extended_immediate = immediate;
 
-        else if(offset == 3){
+    if(signed_rs < signed_extended_immediate){
+        registers.write_reg(rt, 1);
+    }
+    else{
+        registers.write_reg(rt, 0);
+    }
 
-            memory_word = (((memory_word << 24) & 0xFF000000) | (original_word & 0xFFFFFF));
-        }
+    registers.next_instruction_normal();
+
+    return MIPS_OK;
+}
 
-        //if offset is 0 no need to change anything
+//SLTIU
+static mips_status op_sltiu(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        registers.write_reg(rt, memory_word);
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-        registers.next_instruction_normal();
+    //the immediate is already sign extended
+    int32_t signed_extended_immediate = immediate;
+
+    //make the sign extended immediate an unsigned type
+    uint32_t unsigned_immediate = signed_extended_immediate;
+
+    if(registers.read_reg(rs) < unsigned_immediate){
+        registers.write_reg(rt, 1);
+    }
+    else{
+        registers.write_reg(rt, 0);
     }
 
-    //LWR
-    else if(opcode == 0b100110){
+    registers.next_instruction_normal();
 
-        //sign extend the immediate
-        int16_t signed_immediate = immediate;
-        int32_t extended_signed_immediate = signed_immediate;
+    return MIPS_OK;
+}
 
-        uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
-        uint8_t offset = address % 4;
+//XORI
+static mips_status op_xori(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        uint32_t original_word = registers.read_reg(rt);
-        uint32_t memory_word = memory.read_DATA(address - offset);
-    
-        if(offset == 0){
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint32_t immediate = instr.immediate;
 
-            memory_word = (((memory_word >> 24 ) & 0xFF) | (original_word & 0xFFFFFF00));
-        }
-        else if(offset == 1){
+    uint32_t extended_immediate = immediate;
 
-            memory_word = (((memory_word >> 16) & 0xFFFF) | (original_word & 0xFFFF0000));
-        }
+    registers.write_reg(rt, registers.read_reg(rs) ^ extended_immediate);
 
-        else if(offset == 2){
+    registers.next_instruction_normal();
 
-            memory_word = (((memory_word >> 8) & 0xFFFFFF) | (original_word & 0xFF000000));
-        }
+    return MIPS_OK;
+}
 
-        //if offset is 3 no need to change anything
+//J
+static mips_status op_j(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        registers.write_reg(rt, memory_word);
+    uint32_t address = instr.immediate | (registers.read_pc() & 0xF0000000); //the immediate already has the 2 LSB added back
 
-        registers.next_instruction_normal();
-    }
+    //the delay slot runs next, then the PC goes to the target
+    return branch_to(address, registers);
 
-    //SB
-    else if(opcode == 0b101000){
+    return MIPS_OK;
+}
 
-        // std::cerr << "entered SB" << std::endl;
+//JAL
+static mips_status op_jal(const mips_decoded& instr, const std::vector<mips_decoded>&, mips_memory&, mips_registers& registers){
 
-        //sign extend the immediate
-        int16_t signed_immediate = immediate;
-        int32_t extended_signed_immediate = signed_immediate;
+    uint32_t address = instr.immediate | (registers.read_pc() & 0xF0000000); //the immediate already has the 2 LSB added back
 
-        uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
+    registers.write_reg(31, registers.read_pc() + 8);
 
-        // std::cerr << "Address of data is " << std::hex << address << std::endl;
+    //the delay slot runs next, then the PC goes to the target
+    return branch_to(address, registers);
 
-        uint8_t offset = address % 4;
+    return MIPS_OK;
+}
 
-        uint32_t memory_word;
 
-        if(address - offset != 0x30000004){
+///////////////////////////////////////
+///////////// Dispatch ////////////////
+///////////////////////////////////////
 
-            memory_word = memory.read_DATA(address - offset);
-        }
-        else{
+//every handler has the same signature, so they can be called through a table
+typedef mips_status (*instruction_handler)(const mips_decoded& instr, const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers);
 
-            memory_word = 0;
-        }
+//one table for each memory mode, the loads and stores are compiled for it (see mips_memory_paged)
+template<class access>
+struct handler_tables{
 
-        // std::cerr << "Memory word is " << std::hex << memory_word << std::endl;
+    static const instruction_handler table[];
+};
 
-        uint32_t byte = registers.read_reg(rt) & 0xFF;
+//indexed by mips_handler, has to stay in the same order as the enum
+template<class access>
+const instruction_handler handler_tables<access>::table[] = {
 
-        if(offset == 0){
+    op_invalid,
 
-            memory_word = (memory_word & 0xFFFFFF) | (byte << 24);
-        }
-        else if(offset == 1){
+    op_addu, op_jr, op_add, op_and, op_div, op_divu, op_jalr, op_mfhi, op_mflo, op_mthi, op_mtlo, op_mult, op_multu,
+    op_or, op_sll, op_sllv, op_slt, op_sltu, op_sra, op_srav, op_srl, op_srlv, op_sub, op_subu, op_xor,
 
-            memory_word = (memory_word & 0xFF00FFFF) | (byte << 16);
-        }
-        else if(offset == 2){
+    op_lui, op_addiu, op_sw<access>, op_lw<access>, op_ori, op_bne, op_addi, op_andi, op_beq, op_bgez, op_bgezal, op_bgtz, op_blez,
+    op_bltz, op_bltzal, op_lb<access>, op_lbu<access>, op_lh<access>, op_lhu<access>, op_lwl<access>, op_lwr<access>, op_sb<access>,
+    op_sh<access>, op_slti, op_sltiu, op_xori,
 
-            memory_word = (memory_word & 0xFFFF00FF) | (byte << 8);
-        }
-        else if(offset == 3){
+    op_j, op_jal
+};
 
-            memory_word = (memory_word & 0xFFFFFF00) | byte;
-        }
+template<class access>
+mips_status instruction_step(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers){
 
-        memory.write_DATA(memory_word , address - offset);
+    if(registers.in_delay_slot()){
+        return instruction_delay_slot<access>(program, memory, registers);
+    }
 
-        registers.next_instruction_normal();
+    //PC gets set -> the instruction from PC becomes IR -> instruction executes (and sets the next PC)
+
+    if(registers.read_pc() < 0x10000000 || registers.read_pc() > memory.read_LAST_INSTR_ADDRESS()){ //if it is out of range or reached the of of file wihtout going to the address
+        return MIPS_MEMORY_TRAP;
     }
 
-    //SH
-    else if(opcode == 0b101001){
+    const mips_decoded& instr = program[(registers.read_pc() - 0x10000000) >> 2];
 
-        //sign extend the immediate
-        int16_t signed_immediate = immediate;
-        int32_t extended_signed_immediate = signed_immediate;
+    return handler_tables<access>::table[instr.handler](instr, program, memory, registers);
+}
 
-        uint32_t address = registers.read_reg(rs) + extended_signed_immediate;
-        uint8_t offset = address % 4;
-        
-        uint32_t memory_word;
+template<class access>
+mips_status instruction_delay_slot(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers){
 
-        if(address - offset != 0x30000004){
+    //the PC is still on the branch. A branch that is the last instruction has no delay slot, it goes straight to the target
+    if(registers.read_pc() < memory.read_LAST_INSTR_ADDRESS()){
 
-            memory_word = memory.read_DATA(address - offset);
-        }
-        else{
+        const mips_decoded& instr = program[((registers.read_pc() - 0x10000000) >> 2) + 1];
 
-            memory_word = 0;
+        mips_status status = handler_tables<access>::table[instr.handler](instr, program, memory, registers);
+
+        if(status != MIPS_OK){ //the delay slot trapped, exited, or was a taken branch
+            return status;
         }
+    }
 
-        uint32_t LSB = registers.read_reg(rt) & 0xFFFF;
+    return branch_finish(registers);
+}
 
-        if(offset == 0){
-            memory_word = (memory_word & 0xFFFF) | (LSB << 16) ;
-        }
-        else if(offset == 2){
-            memory_word = (memory_word & 0xFFFF0000) | LSB;
-        }
-        else{
-            exit(-11);
-        }
+template<class access>
+mips_status instruction_execute(const mips_decoded& instr, const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers){
 
-        memory.write_DATA(memory_word, address - offset);
+    return handler_tables<access>::table[instr.handler](instr, program, memory, registers);
+}
 
-        registers.next_instruction_normal();
-    }
+template mips_status instruction_step<mips_memory_paged>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&);
+template mips_status instruction_step<mips_memory_guarded>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&);
+template mips_status instruction_delay_slot<mips_memory_paged>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&);
+template mips_status instruction_delay_slot<mips_memory_guarded>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&);
+template mips_status instruction_execute<mips_memory_paged>(const mips_decoded&, const std::vector<mips_decoded>&, mips_memory&, mips_registers&);
+template mips_status instruction_execute<mips_memory_guarded>(const mips_decoded&, const std::vector<mips_decoded>&, mips_memory&, mips_registers&);
 
-    //SLTI
-    else if(opcode == 0b001010){
+//the same, for whichever mode the memory is in
+mips_status instruction_step(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers){
 
-        //make the contents of rs signed
-        int32_t signed_rs = registers.read_reg(rs);
+    return memory.guard_pages() ? instruction_step<mips_memory_guarded>(program, memory, registers) : instruction_step<mips_memory_paged>(program, memory, registers);
+}
 
-        //make the immediate signed and 32 bits
-        int16_t signed_immediate = immediate;
-        int32_t signed_extended_immediate = signed_immediate;
+mips_status instruction_delay_slot(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers){
 
-        if(signed_rs < signed_extended_immediate){
-            registers.write_reg(rt, 1);
-        }
-        else{
-            registers.write_reg(rt, 0);
-        }
+    return memory.guard_pages() ? instruction_delay_slot<mips_memory_guarded>(program, memory, registers)
+                                : instruction_delay_slot<mips_memory_paged>(program, memory, registers);
+}
 
-        registers.next_instruction_normal();
+mips_status instruction_execute(const mips_decoded& instr, const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers){
+
+    return memory.guard_pages() ? instruction_execute<mips_memory_guarded>(instr, program, memory, registers)
+                                : instruction_execute<mips_memory_paged>(instr, program, memory, registers);
+}
+
+//calls the policy's before() for what instruction_step is about to run, if there is anything (a PC out of range traps instead, a delay slot past the end runs nothing)
+template<class policy>
+static inline void policy_before(policy& hooks, const std::vector<mips_decoded>& program, uint32_t last_address, const mips_registers& registers){
+
+    uint32_t pc = registers.read_pc();
+
+    if(registers.in_delay_slot()){
+
+        if(pc < last_address){
+            hooks.before(program[((pc - 0x10000000) >> 2) + 1], pc + 4, registers);
+        }
+    }
+    else if(pc >= 0x10000000 && pc <= last_address){
+        hooks.before(program[(pc - 0x10000000) >> 2], pc, registers);
     }
+}
 
-    //SLTIU
-    else if(opcode == 0b001011){
+template<class policy, class access>
+static mips_status run_table(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps, policy& hooks){
 
-        //sign extend the immediate
-        int16_t signed_immediate = immediate;
-        int32_t signed_extended_immediate = signed_immediate;
+    uint32_t last_address = memory.read_LAST_INSTR_ADDRESS();
 
-        //make the sign extended immediate an unsigned type
-        uint32_t unsigned_immediate = signed_extended_immediate;
+    while(!policy::count_steps || steps > 0){
 
-        if(registers.read_reg(rs) < unsigned_immediate){
-            registers.write_reg(rt, 1);
+        if(policy::count_steps){
+            steps--;
         }
-        else{
-            registers.write_reg(rt, 0);
+
+        if(policy::instrument){
+            policy_before(hooks, program, last_address, registers);
         }
 
-        registers.next_instruction_normal();
-    }
+        //execute the predecoded instruction pointed at by the PC (or the delay slot after it). the PC is increased in the function, as they take account of branches etc.
+        mips_status status = instruction_step<access>(program, memory, registers);
 
-    //XORI
-    else if(opcode == 0b001110){
+        if(status != MIPS_OK){
+            return status;
+        }
+    }
 
-        uint32_t extended_immediate = immediate;
+    return MIPS_STEP_LIMIT;
+}
 
-        registers.write_reg(rt, registers.read_reg(rs) ^ extended_immediate);
+template<class policy>
+mips_status program_run_table(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps, policy& hooks){
 
-        registers.next_instruction_normal();
+    //the memory mode doesn't change during a run, so it is only looked at here
+    if(memory.guard_pages()){
+        return run_table<policy, mips_memory_guarded>(program, memory, registers, steps, hooks);
     }
 
+    return run_table<policy, mips_memory_paged>(program, memory, registers, steps, hooks);
+}
 
-    else{
+template<class policy, class access>
+static mips_status run_threaded(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps, policy& hooks){
 
-        // std::cerr << "not a valid I type instruction" << std::endl;
-        //invalid opcode or not implemented yet
-        exit(-12);
+#if defined(__GNUC__)
 
-    }
-}
+    //computed goto: every handler ends with its own indirect jump to the next one, so the branch predictor can learn the instruction sequences
 
-void jtype(uint8_t opcode, uint32_t short_address, mips_memory& memory, mips_registers& registers){
-    
-    //J
-    if(opcode == 0b000010){
+    //indexed by mips_handler, has to stay in the same order as the enum
+    static void* const labels[] = {
 
-        // std::cerr << "entered J" << std::endl;
+        &&L_INVALID,
 
-        uint32_t address = (short_address << 2) | (registers.read_pc() & 0xF0000000);
+        &&L_ADDU, &&L_JR, &&L_ADD, &&L_AND, &&L_DIV, &&L_DIVU, &&L_JALR, &&L_MFHI, &&L_MFLO, &&L_MTHI, &&L_MTLO, &&L_MULT, &&L_MULTU,
+        &&L_OR, &&L_SLL, &&L_SLLV, &&L_SLT, &&L_SLTU, &&L_SRA, &&L_SRAV, &&L_SRL, &&L_SRLV, &&L_SUB, &&L_SUBU, &&L_XOR,
 
-        // std::cerr << "address is " << std::hex << address << std::endl;
-        //branch delay
-        if(registers.read_pc() < memory.read_LAST_INSTR_ADDRESS()){ //only executes the branch delay instruction if it there is an instruction after
+        &&L_LUI, &&L_ADDIU, &&L_SW, &&L_LW, &&L_ORI, &&L_BNE, &&L_ADDI, &&L_ANDI, &&L_BEQ, &&L_BGEZ, &&L_BGEZAL, &&L_BGTZ, &&L_BLEZ,
+        &&L_BLTZ, &&L_BLTZAL, &&L_LB, &&L_LBU, &&L_LH, &&L_LHU, &&L_LWL, &&L_LWR, &&L_SB, &&L_SH, &&L_SLTI, &&L_SLTIU, &&L_XORI,
 
-            instruction_decode_run(memory.read_INSTR(registers.read_pc()+4), memory, registers);
-        }     
+        &&L_J, &&L_JAL
+    };
 
-        //if the address points at 0x0, which means the program has finished execution, exit and indicate success
-        if(address == 0){
+    const mips_decoded* instr;
+    mips_status status;
+    uint32_t last_address = memory.read_LAST_INSTR_ADDRESS();
+    uint64_t steps_left = steps; //kept in a local so it can stay in a register, written back when stopping
 
-            uint8_t exit_code = registers.read_reg(2);
+    #define STOP(why) { steps = steps_left; return why; }
 
-            exit(exit_code);
+    //what the policy leaves out is a constant false, so the compiler drops it
+    #define COUNT_STEP() \
+        if(policy::count_steps){ \
+            if(steps_left == 0){ STOP(MIPS_STEP_LIMIT); } \
+            steps_left--; \
         }
 
-        //if the address is out of bounds, exit and indicate memory error
-        else if(address < 0x10000000 || address >= 0x11000000){
-               
-            exit(-11);
+    //same checks as program_run_table: stop if the PC left the binary or the steps ran out, otherwise jump straight to the handler of the next instruction
+    #define DISPATCH() \
+        if(registers.read_pc() < 0x10000000 || registers.read_pc() > last_address){ STOP(MIPS_MEMORY_TRAP); } \
+        COUNT_STEP(); \
+        instr = &program[(registers.read_pc() - 0x10000000) >> 2]; \
+        if(policy::instrument){ hooks.before(*instr, registers.read_pc(), registers); } \
+        goto *labels[instr->handler];
+
+    //a taken branch leaves its delay slot to run next, it counts as a step of its own
+    #define DELAY_SLOT() \
+        if(registers.in_delay_slot()){ \
+            COUNT_STEP(); \
+            if(policy::instrument){ policy_before(hooks, program, last_address, registers); } \
+            status = instruction_delay_slot<access>(program, memory, registers); if(status != MIPS_OK){ STOP(status); } \
         }
 
-        registers.next_instruction_branch(address);
-    }
+    #define HANDLER(NAME, function) \
+        L_##NAME: status = function(*instr, program, memory, registers); if(status != MIPS_OK){ STOP(status); } DISPATCH();
 
-    //JAL
-    else if(opcode == 0b000011){
+    #define BRANCH(NAME, function) \
+        L_##NAME: status = function(*instr, program, memory, registers); if(status != MIPS_OK){ STOP(status); } DELAY_SLOT(); DISPATCH();
 
-        // std::cerr << "entered JAL" << std::endl;
+    DELAY_SLOT(); //the last run may have stopped between a branch and its delay slot
+    DISPATCH();
 
-        uint32_t address = (short_address << 2) | (registers.read_pc() & 0xF0000000);
+    HANDLER(INVALID, op_invalid)
 
-        registers.write_reg(31, registers.read_pc() + 8);
+    HANDLER(ADDU, op_addu) BRANCH(JR, op_jr) HANDLER(ADD, op_add) HANDLER(AND, op_and) HANDLER(DIV, op_div) HANDLER(DIVU, op_divu)
+    BRANCH(JALR, op_jalr) HANDLER(MFHI, op_mfhi) HANDLER(MFLO, op_mflo) HANDLER(MTHI, op_mthi) HANDLER(MTLO, op_mtlo) HANDLER(MULT, op_mult)
+    HANDLER(MULTU, op_multu) HANDLER(OR, op_or) HANDLER(SLL, op_sll) HANDLER(SLLV, op_sllv) HANDLER(SLT, op_slt) HANDLER(SLTU, op_sltu)
+    HANDLER(SRA, op_sra) HANDLER(SRAV, op_srav) HANDLER(SRL, op_srl) HANDLER(SRLV, op_srlv) HANDLER(SUB, op_sub) HANDLER(SUBU, op_subu)
+    HANDLER(XOR, op_xor)
 
-        //branch delay
-        if(registers.read_pc() < memory.read_LAST_INSTR_ADDRESS()){ //only executes the branch delay instruction if it there is an instruction after
+    HANDLER(LUI, op_lui) HANDLER(ADDIU, op_addiu) HANDLER(SW, op_sw<access>) HANDLER(LW, op_lw<access>) HANDLER(ORI, op_ori) BRANCH(BNE, op_bne)
+    HANDLER(ADDI, op_addi) HANDLER(ANDI, op_andi) BRANCH(BEQ, op_beq) BRANCH(BGEZ, op_bgez) BRANCH(BGEZAL, op_bgezal) BRANCH(BGTZ, op_bgtz)
+    BRANCH(BLEZ, op_blez) BRANCH(BLTZ, op_bltz) BRANCH(BLTZAL, op_bltzal) HANDLER(LB, op_lb<access>) HANDLER(LBU, op_lbu<access>)
+    HANDLER(LH, op_lh<access>) HANDLER(LHU, op_lhu<access>) HANDLER(LWL, op_lwl<access>) HANDLER(LWR, op_lwr<access>) HANDLER(SB, op_sb<access>)
+    HANDLER(SH, op_sh<access>) HANDLER(SLTI, op_slti) HANDLER(SLTIU, op_sltiu) HANDLER(XORI, op_xori)
 
-            instruction_decode_run(memory.read_INSTR(registers.read_pc()+4), memory, registers);
-        }  
+    BRANCH(J, op_j) BRANCH(JAL, op_jal)
 
-        //if the address points at 0x0, which means the program has finished execution, exit and indicate success
-        if(address == 0){
+    #undef BRANCH
+    #undef HANDLER
+    #undef DELAY_SLOT
+    #undef DISPATCH
+    #undef COUNT_STEP
+    #undef STOP
 
-            uint8_t exit_code = registers.read_reg(2);
+#else
 
-            exit(exit_code);
-        }
+    //no computed goto, fall back to the jump table
+    return run_table<policy, access>(program, memory, registers, steps, hooks);
 
-        //if the address is out of bounds, exit and indicate memory error
-        else if(address < 0x10000000 || address >= 0x11000000){
-               
-            exit(-11);
-        }
+#endif
+}
+
+template<class policy>
+mips_status program_run_threaded(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps, policy& hooks){
 
-        registers.next_instruction_branch(address);
+    if(memory.guard_pages()){
+        return run_threaded<policy, mips_memory_guarded>(program, memory, registers, steps, hooks);
     }
 
-    else{
-        
+    return run_threaded<policy, mips_memory_paged>(program, memory, registers, steps, hooks);
+}
 
-        // std::cerr << "invalid J type instruction, current PC: " << std::hex << registers.read_pc() << std::endl;
-        exit(-12);
-    } 
+mips_status program_run_table(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps){
+
+    mips_policy_release hooks;
+
+    return program_run_table(program, memory, registers, steps, hooks);
+}
+
+mips_status program_run_threaded(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps){
+
+    mips_policy_release hooks;
+
+    return program_run_threaded(program, memory, registers, steps, hooks);
 }
 
+void mips_policy_trace::before(const mips_decoded& instr, uint32_t pc, const mips_registers& registers){
+
+    std::ios_base::fmtflags flags = out->flags();
+
+    *out << std::hex << std::setfill('0') << std::setw(8) << pc << ": " << instruction_name(instr.handler)
+         << " rs $" << std::dec << (int)instr.rs << "=0x" << std::hex << registers.read_reg(instr.rs)
+         << " rt $" << std::dec << (int)instr.rt << "=0x" << std::hex << registers.read_reg(instr.rt)
+         << " rd $" << std::dec << (int)instr.rd << " imm 0x" << std::hex << instr.immediate << "\n";
+
+    out->flags(flags);
+}
+
+//every policy the loops are compiled for, the templates are only defined in here
+template mips_status program_run_table<mips_policy_release>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&, uint64_t&, mips_policy_release&);
+template mips_status program_run_table<mips_policy_unlimited>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&, uint64_t&, mips_policy_unlimited&);
+template mips_status program_run_table<mips_policy_trace>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&, uint64_t&, mips_policy_trace&);
+template mips_status program_run_table<mips_policy_mix>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&, uint64_t&, mips_policy_mix&);
+template mips_status program_run_table<mips_policy_calls>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&, uint64_t&, mips_policy_calls&);
+template mips_status program_run_table<mips_policy_timing>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&, uint64_t&, mips_policy_timing&);
+template mips_status program_run_table<mips_policy_cache>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&, uint64_t&, mips_policy_cache&);
+
+template mips_status program_run_threaded<mips_policy_release>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&, uint64_t&, mips_policy_release&);
+template mips_status program_run_threaded<mips_policy_unlimited>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&, uint64_t&, mips_policy_unlimited&);
+template mips_status program_run_threaded<mips_policy_trace>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&, uint64_t&, mips_policy_trace&);
+template mips_status program_run_threaded<mips_policy_mix>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&, uint64_t&, mips_policy_mix&);
+template mips_status program_run_threaded<mips_policy_calls>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&, uint64_t&, mips_policy_calls&);
+template mips_status program_run_threaded<mips_policy_timing>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&, uint64_t&, mips_policy_timing&);
+template mips_status program_run_threaded<mips_policy_cache>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&, uint64_t&, mips_policy_cache&);
+template mips_status program_run_threaded<mips_policy_every>(const std::vector<mips_decoded>&, mips_memory&, mips_registers&, uint64_t&, mips_policy_every&);
+
 
 
@@ -6,21 +6,111 @@
 
 #include "mips_memory.hpp"
 #include "mips_registers.hpp"
+#include "mips_status.hpp"
 
 #ifndef MIPS_BREAKDOWN
 #define MIPS_BREAKDOWN
 
-//splits the instruction into components and then calls the respective follow up function which executes it
-void instruction_decode_run(uint32_t input, mips_memory& memory, mips_registers& registers); 
+//handler ids, one for every implemented instruction. Used as the index into the dispatch tables in mips_breakdown.cpp, so the order matters
+enum mips_handler : uint8_t {
 
-//executes an R type instruction FINISH IMPLEMENTING
-void rtype(uint8_t rs, uint8_t rt, uint8_t rd, uint8_t shamt, uint8_t funct, mips_memory& memory, mips_registers& registers);
+    OP_INVALID,
 
-//executes an I type instruction IMPLEMENT
-void itype(uint8_t opcode, uint8_t rs, uint8_t rt, uint16_t immediate, mips_memory& memory, mips_registers& registers);
+    //R type
+    OP_ADDU, OP_JR, OP_ADD, OP_AND, OP_DIV, OP_DIVU, OP_JALR, OP_MFHI, OP_MFLO, OP_MTHI, OP_MTLO, OP_MULT, OP_MULTU,
+    OP_OR, OP_SLL, OP_SLLV, OP_SLT, OP_SLTU, OP_SRA, OP_SRAV, OP_SRL, OP_SRLV, OP_SUB, OP_SUBU, OP_XOR,
 
-//executes an J type instruction IMPLEMENT
-void jtype(uint8_t opcode, uint32_t short_address, mips_memory& memory, mips_registers& registers);
+    //I type
+    OP_LUI, OP_ADDIU, OP_SW, OP_LW, OP_ORI, OP_BNE, OP_ADDI, OP_ANDI, OP_BEQ, OP_BGEZ, OP_BGEZAL, OP_BGTZ, OP_BLEZ,
+    OP_BLTZ, OP_BLTZAL, OP_LB, OP_LBU, OP_LH, OP_LHU, OP_LWL, OP_LWR, OP_SB, OP_SH, OP_SLTI, OP_SLTIU, OP_XORI,
+
+    //J type
+    OP_J, OP_JAL
+};
+
+//an instruction that has already been split into components. 8 bytes, so the whole binary stays compact
+struct mips_decoded{
+
+    uint8_t handler; //which instruction it is (mips_handler)
+
+    uint8_t rs;
+    uint8_t rt;
+    uint8_t rd;
+
+    //already extended the way the instruction needs it: sign extended for arithmetic/memory, zero extended for logic,
+    //shifted by 16 for LUI, the byte offset to the branch target (offset << 2, plus 4) for branches, the shifted address for J types and shamt for shifts
+    uint32_t immediate;
+};
+
+//splits an instruction into components once, and works out which handler executes it. Invalid instructions get OP_INVALID, they only exit when executed
+mips_decoded instruction_decode(uint32_t input);
+
+//decodes the whole of ADDR_INSTR, the record for an address is at index (address - 0x10000000) / 4
+std::vector<mips_decoded> program_decode(mips_memory& memory);
+
+//true for the branches and jumps, the instructions that have a delay slot and can change the PC to something other than PC + 4
+bool instruction_is_branch(uint8_t handler);
+
+//whether the conditional branch instr goes to its target, from the registers before it runs. False for anything else
+inline bool mips_branch_taken(const mips_decoded& instr, const mips_registers& registers){
+
+    uint32_t rs = registers.read_reg(instr.rs);
+
+    switch(instr.handler){
+
+        case OP_BEQ: return rs == registers.read_reg(instr.rt);
+        case OP_BNE: return rs != registers.read_reg(instr.rt);
+        case OP_BGEZ: case OP_BGEZAL: return (int32_t)rs >= 0;
+        case OP_BGTZ: return (int32_t)rs > 0;
+        case OP_BLEZ: return (int32_t)rs <= 0;
+        case OP_BLTZ: case OP_BLTZAL: return (int32_t)rs < 0;
+
+        default: return false;
+    }
+}
+
+//the mnemonic of a handler ("addu", ...), "invalid" for OP_INVALID
+const char* instruction_name(uint8_t handler);
+
+//every handler returns MIPS_OK if the program carries on, or why it stopped. Nothing in here calls exit()
+
+//a taken branch doesn't run its delay slot itself: it leaves the PC on the branch and marks the delay slot as pending in mips_registers.
+//the delay slot then runs as a step of its own, and after it the PC goes to the branch target, so nothing recurses
+
+//one step: runs the pending delay slot if there is one, otherwise the predecoded instruction pointed at by the PC (MIPS_MEMORY_TRAP if the PC is outside the binary)
+mips_status instruction_step(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers);
+
+//runs the pending delay slot (nothing if the branch was the last instruction) and goes to the branch target
+mips_status instruction_delay_slot(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers);
+
+//executes one predecoded instruction, wherever it is (a branch only marks its delay slot as pending)
+mips_status instruction_execute(const mips_decoded& instr, const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers);
+
+//the same three for one memory mode (mips_memory_paged or mips_memory_guarded), which has to be the one memory is in. The ones above look
+//at the mode every time, an engine looks once when a run starts and calls these
+template<class access>
+mips_status instruction_step(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers);
+
+template<class access>
+mips_status instruction_delay_slot(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers);
+
+template<class access>
+mips_status instruction_execute(const mips_decoded& instr, const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers);
+
+//runs the program from the current PC until it stops or steps instructions have run (a delay slot is a step of its own).
+//steps is decreased by the number that ran, so the run can be continued by calling it again
+mips_status program_run_table(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps);
+
+//same as program_run_table, using threaded code (computed goto) where the compiler supports it
+mips_status program_run_threaded(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps);
+
+//the same two loops, compiled for a policy (see mips_policy.hpp) that says whether steps are counted and what else runs with every instruction.
+//the versions above are these with mips_policy_release
+template<class policy>
+mips_status program_run_table(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps, policy& hooks);
+
+template<class policy>
+mips_status program_run_threaded(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps, policy& hooks);
 
 #endif
 
@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mips_cache.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+static bool cache_power_of_2(uint32_t value){
+
+    return value != 0 && (value & (value - 1)) == 0;
+}
+
+bool mips_cache_config::parse(const std::string& text){
+
+    mips_cache_config parsed = *this;
+
+    std::istringstream fields(text);
+    std::string field;
+
+    for(int i = 0; std::getline(fields, field, ','); i++){
+
+        char* end;
+        unsigned long value = std::strtoul(field.c_str(), &end, 10);
+
+        if(i == 0 && *end == 'K'){ //16K
+            value *= 1024;
+            end++;
+        }
+
+        if(i < 3){
+
+            if(*end != '\0' || end == field.c_str() || value > 0x80000000){
+                return false;
+            }
+
+            if(i == 0){
+                parsed.size = value;
+            }
+            else if(i == 1){
+                parsed.ways = value;
+            }
+            else{
+                parsed.line = value;
+            }
+        }
+        else if(field == "lru"){
+            parsed.replacement = REPLACE_LRU;
+        }
+        else if(field == "fifo"){
+            parsed.replacement = REPLACE_FIFO;
+        }
+        else if(field == "random"){
+            parsed.replacement = REPLACE_RANDOM;
+        }
+        else if(field == "wb"){
+            parsed.write_back = true;
+        }
+        else if(field == "wt"){
+            parsed.write_back = false;
+        }
+        else{
+            return false;
+        }
+    }
+
+    //a line holds at least a word, and there is at least one set
+    if(!cache_power_of_2(parsed.size) || !cache_power_of_2(parsed.ways) || !cache_power_of_2(parsed.line) || parsed.line < 4
+       || (uint64_t)parsed.ways * parsed.line > parsed.size){
+        return false;
+    }
+
+    *this = parsed;
+
+    return true;
+}
+
+mips_cache::mips_cache(const mips_cache_config& config_in) : config(config_in){
+
+    line_bits = 0;
+
+    while((1u << line_bits) < config.line){
+        line_bits++;
+    }
+
+    set_mask = config.size / (config.ways * config.line) - 1;
+
+    tags.resize(config.size / config.line);
+    stamps.resize(config.size / config.line);
+    dirty.resize(config.size / config.line);
+
+    clear();
+}
+
+void mips_cache::clear(){
+
+    std::fill(tags.begin(), tags.end(), 0);
+    std::fill(stamps.begin(), stamps.end(), 0);
+    std::fill(dirty.begin(), dirty.end(), 0);
+
+    clock = 0;
+    seed = 0x9E3779B9;
+
+    last_line = UINT32_MAX; //no line is that, they are at most 30 bits
+    last_slot = 0;
+
+    accesses = 0;
+    hits = 0;
+    misses = 0;
+    evictions = 0;
+    writebacks = 0;
+    writes = 0;
+
+    std::fill(pc_accesses.begin(), pc_accesses.end(), 0);
+    std::fill(pc_misses.begin(), pc_misses.end(), 0);
+}
+
+void mips_cache::count_by_pc(uint32_t instructions){
+
+    pc_accesses.assign(instructions, 0);
+    pc_misses.assign(instructions, 0);
+}
+
+int mips_cache::find(uint32_t first, uint32_t tag) const{
+
+    const uint32_t* set = &tags[first];
+    uint32_t ways = config.ways;
+
+#if defined(__SSE2__)
+
+    if(ways >= 4){ //a set of 4 or more ways is a multiple of 16 bytes from the start of tags, so it can be loaded 4 tags at a time
+
+        __m128i wanted = _mm_set1_epi32(tag);
+
+        for(uint32_t way = 0; way < ways; way += 4){
+
+            int match = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(_mm_loadu_si128((const __m128i*)(set + way)), wanted)));
+
+            if(match != 0){
+                return way + __builtin_ctz(match);
+            }
+        }
+
+        return -1;
+    }
+
+#endif
+
+    for(uint32_t way = 0; way < ways; way++){
+
+        if(set[way] == tag){
+            return way;
+        }
+    }
+
+    return -1;
+}
+
+bool mips_cache::access_set(uint32_t line, bool write, uint32_t pc){
+
+    uint32_t first = (line & set_mask) * config.ways;
+    uint32_t tag = (line << 1) | 1;
+
+    clock++;
+
+    int way = find(first, tag);
+
+    if(way >= 0){
+
+        uint32_t slot = first + way;
+
+        hits++;
+
+        if(config.replacement == REPLACE_LRU){
+            stamps[slot] = clock;
+        }
+
+        if(write){
+            dirty[slot] |= config.write_back;
+            writes += !config.write_back;
+        }
+
+        last_line = line;
+        last_slot = slot;
+
+        return true;
+    }
+
+    misses++;
+
+    uint32_t index = (pc - 0x10000000) >> 2;
+
+    if(index < pc_misses.size()){
+        pc_misses[index]++;
+    }
+
+    if(write && !config.write_back){ //write through doesn't allocate, the write goes to memory
+        writes++;
+        return false;
+    }
+
+    //an invalid way if there is one, otherwise the victim the policy picks
+    int empty_way = find(first, 0);
+    uint32_t slot = first;
+
+    if(empty_way >= 0){
+        slot = first + empty_way;
+    }
+    else if(config.replacement == REPLACE_RANDOM){
+
+        seed ^= seed << 13; //xorshift
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+
+        slot = first + (seed & (config.ways - 1));
+    }
+    else{
+
+        //the oldest: least recently used (LRU) or filled (FIFO)
+        for(uint32_t i = 1; i < config.ways; i++){
+
+            if(stamps[first + i] < stamps[slot]){
+                slot = first + i;
+            }
+        }
+    }
+
+    if(tags[slot] != 0){
+
+        evictions++;
+        writebacks += dirty[slot];
+    }
+
+    tags[slot] = tag;
+    stamps[slot] = clock;
+    dirty[slot] = write; //only a write back cache gets here with a write
+
+    last_line = line;
+    last_slot = slot;
+
+    return false;
+}
+
+void mips_cache::count_pc(uint32_t pc){
+
+    uint32_t index = (pc - 0x10000000) >> 2;
+
+    if(index < pc_accesses.size()){
+        pc_accesses[index]++;
+    }
+}
+
+void mips_cache::report(std::ostream& out, const std::string& name) const{
+
+    out << name << "," << accesses << "," << hits << "," << misses << "," << evictions << "," << writebacks << "," << writes << "\n";
+}
+
+void mips_caches::report(std::ostream& out) const{
+
+    out << "cache,accesses,hits,misses,evictions,writebacks,memory_writes\n";
+
+    instr.report(out, "instr");
+    data.report(out, "data");
+}
+
+void mips_cache::report_pc(std::ostream& out) const{
+
+    std::vector<std::pair<uint64_t, uint32_t> > order; //misses, index
+
+    for(uint32_t i = 0; i < pc_misses.size(); i++){
+
+        if(pc_misses[i] > 0){
+            order.push_back(std::make_pair(pc_misses[i], i));
+        }
+    }
+
+    std::sort(order.begin(), order.end(), [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b){
+        return (a.first != b.first) ? a.first > b.first : a.second < b.second;
+    });
+
+    out << "pc,accesses,misses\n";
+
+    char pc[16];
+
+    for(size_t i = 0; i < order.size(); i++){
+
+        std::snprintf(pc, sizeof(pc), "0x%08x", 0x10000000 + 4 * order[i].second);
+        out << pc << "," << pc_accesses[order[i].second] << "," << order[i].first << "\n";
+    }
+}
@@ -0,0 +1,147 @@
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "mips_breakdown.hpp"
+#include "mips_registers.hpp"
+
+#ifndef MIPS_CACHE
+#define MIPS_CACHE
+
+enum mips_replacement{ REPLACE_LRU, REPLACE_FIFO, REPLACE_RANDOM };
+
+//what a cache looks like. Sizes are in bytes and all powers of 2
+struct mips_cache_config{
+
+    uint32_t size;
+    uint32_t ways;
+    uint32_t line;
+    mips_replacement replacement;
+    bool write_back; //write back and allocate on a write miss, otherwise write through without allocating
+
+    mips_cache_config() : size(16384), ways(4), line(32), replacement(REPLACE_LRU), write_back(true) {}
+
+    //"SIZE,WAYS,LINE[,lru|fifo|random][,wb|wt]", SIZE can end in K. False (and nothing changed) if it is anything else or doesn't make a cache
+    bool parse(const std::string& text);
+};
+
+//one cache, only tags: it counts what would hit and miss, the data is where it always is.
+//the tags of a set are next to each other (the line address with a valid bit, so a lookup is one compare per way, four at a time with SSE2),
+//and the line the last access was in is checked before the set, so a run of accesses to one line doesn't look at the set at all
+class mips_cache{
+
+    public:
+
+    mips_cache(const mips_cache_config& config_in = mips_cache_config());
+
+    //invalid again, the counts to 0
+    void clear();
+
+    //counts per instruction (by PC) as well, for the report_pc. Instructions has to be the size of the binary in words
+    void count_by_pc(uint32_t instructions);
+
+    //one access at address by the instruction at pc. Returns true if it hit
+    bool access(uint32_t address, bool write, uint32_t pc){
+
+        uint32_t line = address >> line_bits;
+
+        accesses++;
+
+        if(!pc_accesses.empty()){
+            count_pc(pc);
+        }
+
+        if(line == last_line){ //most accesses are to the line the last one was in
+
+            hits++;
+            dirty[last_slot] |= write && config.write_back;
+            writes += write && !config.write_back;
+
+            return true;
+        }
+
+        return access_set(line, write, pc);
+    }
+
+    //a "name,accesses,hits,misses,evictions,writebacks,memory_writes" line
+    void report(std::ostream& out, const std::string& name) const;
+
+    //"pc,accesses,misses" for every instruction that missed, the most misses first
+    void report_pc(std::ostream& out) const;
+
+    private:
+
+    bool access_set(uint32_t line, bool write, uint32_t pc);
+
+    void count_pc(uint32_t pc);
+
+    //the way line is in, in the set starting at first, -1 if it isn't
+    int find(uint32_t first, uint32_t tag) const;
+
+    mips_cache_config config;
+
+    uint32_t line_bits;
+    uint32_t set_mask;
+
+    std::vector<uint32_t> tags;   //sets * ways: line address << 1 | 1, 0 if invalid
+    std::vector<uint64_t> stamps; //when the line was last used (LRU) or filled (FIFO)
+    std::vector<uint8_t> dirty;
+
+    uint64_t clock;
+    uint32_t seed; //for REPLACE_RANDOM
+
+    uint32_t last_line; //the line the last access hit or filled, and where it is
+    uint32_t last_slot;
+
+    uint64_t accesses;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t evictions;
+    uint64_t writebacks; //dirty lines evicted
+    uint64_t writes;     //writes that went to memory (write through)
+
+    std::vector<uint64_t> pc_accesses; //by instruction, empty unless count_by_pc
+    std::vector<uint64_t> pc_misses;
+};
+
+//an L1 instruction and data cache run on every instruction by mips_policy_cache (see mips_simulator::set_caches): the fetch of every
+//instruction (delay slots too) goes through instr, every load and store outside the I/O page through data
+struct mips_caches{
+
+    mips_cache instr;
+    mips_cache data;
+
+    mips_caches(const mips_cache_config& instr_config, const mips_cache_config& data_config) : instr(instr_config), data(data_config) {}
+
+    //both caches' counts as CSV, with a header
+    void report(std::ostream& out) const;
+
+    void before(const mips_decoded& instr_in, uint32_t pc, const mips_registers& registers){
+
+        instr.access(pc, false, pc);
+
+        uint32_t address = registers.read_reg(instr_in.rs) + instr_in.immediate;
+
+        switch(instr_in.handler){
+
+            case OP_LB: case OP_LBU: case OP_LH: case OP_LHU: case OP_LW: case OP_LWL: case OP_LWR:
+
+                if((address >> 12) != 0x30000){
+                    data.access(address, false, pc);
+                }
+                break;
+
+            case OP_SB: case OP_SH: case OP_SW:
+
+                if((address >> 12) != 0x30000){
+                    data.access(address, true, pc);
+                }
+                break;
+
+            default: break;
+        }
+    }
+};
+
+#endif
@@ -0,0 +1,472 @@
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <thread>
+
+#include "mips_console.hpp"
+
+#if defined(__unix__)
+#include <cerrno>
+#include <fcntl.h>
+#include <csignal>
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+///////////////////////////////
+//////////// RING /////////////
+///////////////////////////////
+
+size_t mips_ring::push(const uint8_t* data, size_t length){
+
+    size_t end = tail.load(std::memory_order_relaxed);
+
+    head_seen = head.load(std::memory_order_acquire);
+    length = std::min(length, SIZE - (end - head_seen));
+
+    //up to the end of the array, then the rest from the start
+    size_t first = std::min(length, SIZE - (end & (SIZE - 1)));
+
+    std::memcpy(&bytes[end & (SIZE - 1)], data, first);
+    std::memcpy(bytes, data + first, length - first);
+
+    tail.store(end + length, std::memory_order_release);
+
+    return length;
+}
+
+size_t mips_ring::pop(uint8_t* data, size_t length){
+
+    size_t start = head.load(std::memory_order_relaxed);
+
+    tail_seen = tail.load(std::memory_order_acquire);
+    length = std::min(length, tail_seen - start);
+
+    size_t first = std::min(length, SIZE - (start & (SIZE - 1)));
+
+    std::memcpy(data, &bytes[start & (SIZE - 1)], first);
+    std::memcpy(data + first, bytes, length - first);
+
+    head.store(start + length, std::memory_order_release);
+
+    return length;
+}
+
+
+///////////////////////////////
+/////////// CONSOLE ///////////
+///////////////////////////////
+
+std::atomic<bool> mips_console::abandoned(false);
+
+void mips_console::abandon(){
+
+    abandoned.store(true);
+}
+
+#if defined(__unix__)
+
+mips_console::mips_console() : reading(false), input_end(false), input_error(false), output_error(false), writing(false), sleeping(false), stopping(false), put_count(0), threaded(false){
+
+    if(pipe(wake_pipe) != 0){ //no I/O thread without it, get and put do it themselves then
+        return;
+    }
+
+    //with stdin/stdout closed the pipe would get their numbers, and the I/O thread would take it for them: move it above 2
+    for(int i = 0; i < 2; i++){
+
+        if(wake_pipe[i] <= 2){
+
+            int moved = fcntl(wake_pipe[i], F_DUPFD, 3);
+            close(wake_pipe[i]);
+            wake_pipe[i] = moved;
+        }
+    }
+
+    if(wake_pipe[0] < 0 || wake_pipe[1] < 0){
+
+        if(wake_pipe[0] >= 0){
+            close(wake_pipe[0]);
+        }
+        if(wake_pipe[1] >= 0){
+            close(wake_pipe[1]);
+        }
+
+        return;
+    }
+
+    fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+
+    //the I/O thread takes no signals, so the timer ones (the watchdog, the sampler) go to the thread running the program
+    sigset_t all, before;
+    sigfillset(&all);
+    pthread_sigmask(SIG_SETMASK, &all, &before);
+
+    io = std::thread(&mips_console::io_loop, this);
+    threaded = true;
+
+    pthread_sigmask(SIG_SETMASK, &before, NULL);
+}
+
+mips_console::~mips_console(){
+
+    if(!threaded){
+        return;
+    }
+
+    if(abandoned.load()){ //the I/O thread can be stuck in a write that never ends, so the process doesn't wait for it
+        io.detach();
+        return;
+    }
+
+    stopping.store(true);
+    sleeping.store(true); //so wake() always writes
+    wake();
+
+    io.join(); //it writes the rest of the output first
+
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+}
+
+void mips_console::wake(){
+
+    //only one wake per poll(): the I/O thread sets sleeping before it goes in
+    if(sleeping.exchange(false)){
+
+        char byte = 0;
+        ssize_t written = write(wake_pipe[1], &byte, 1);
+        (void)written; //if the pipe is full there is a wake in it already
+    }
+}
+
+int mips_console::get_wait(){
+
+    if(!threaded){
+
+        uint8_t byte;
+        ssize_t got = read(0, &byte, 1);
+
+        if(got < 0 && errno != EBADF){ //a closed stdin is just the end of the input, like the I/O thread sees it
+            input_error.store(true);
+        }
+
+        return (got == 1) ? byte : EOF;
+    }
+
+    if(input_end.load() || input_error.load()){
+        return EOF;
+    }
+
+    //nothing read yet: the I/O thread starts/carries on reading (and writes the output first, so a prompt shows up)
+    reading.store(true);
+    wake();
+
+    std::unique_lock<std::mutex> guard(lock);
+
+    if(!wait_changed(guard, [this]{ return input.size() > 0 || input_end.load() || input_error.load(); })){
+        input_error.store(true);
+        return EOF;
+    }
+
+    uint8_t byte;
+
+    return input.pop(byte) ? byte : EOF;
+}
+
+bool mips_console::put_wait(uint8_t byte){
+
+    if(output_error.load()){
+        return false;
+    }
+
+    if(!threaded){
+        return write(1, &byte, 1) == 1;
+    }
+
+    while(!output.push(byte)){ //full: wait for the I/O thread to make room
+
+        wake();
+
+        std::unique_lock<std::mutex> guard(lock);
+
+        if(!wait_changed(guard, [this]{ return output.space() > 0 || output_error.load(); })){
+            output_error.store(true);
+        }
+
+        if(output_error.load()){
+            return false;
+        }
+    }
+
+    return true;
+}
+
+void mips_console::put_check(){
+
+    if(output.size() >= mips_ring::SIZE / 2){
+        wake();
+    }
+}
+
+size_t mips_console::get(uint8_t* data, size_t length){
+
+    if(!threaded){
+
+        size_t done = 0;
+
+        while(done < length){
+
+            ssize_t got = read(0, data + done, length - done);
+
+            if(got < 0 && errno == EINTR){
+                continue;
+            }
+            if(got <= 0){
+                input_error.store(got < 0 && errno != EBADF);
+                break;
+            }
+
+            done += got;
+        }
+
+        return done;
+    }
+
+    size_t done = input.pop(data, length);
+
+    //the ring has run out: a byte at a time waits for the next read (or the end), then the rest of that comes in one go
+    while(done < length){
+
+        int byte = get_wait();
+
+        if(byte == EOF){
+            break;
+        }
+
+        data[done++] = byte;
+        done += input.pop(data + done, length - done);
+    }
+
+    return done;
+}
+
+bool mips_console::put(const uint8_t* data, size_t length){
+
+    if(output_error.load()){
+        return false;
+    }
+
+    if(!threaded){
+
+        for(size_t done = 0; done < length; ){
+
+            ssize_t written = write(1, data + done, length - done);
+
+            if(written < 0 && errno != EINTR){
+                return false;
+            }
+            if(written > 0){
+                done += written;
+            }
+        }
+
+        return true;
+    }
+
+    size_t done = output.push(data, length);
+
+    while(done < length){ //full: wait for the I/O thread to make room
+
+        wake();
+
+        std::unique_lock<std::mutex> guard(lock);
+
+        if(!wait_changed(guard, [this]{ return output.space() > 0 || output_error.load(); })){
+            output_error.store(true);
+        }
+
+        if(output_error.load()){
+            return false;
+        }
+
+        done += output.push(data + done, length - done);
+    }
+
+    put_check();
+
+    return true;
+}
+
+void mips_console::flush(){
+
+    if(!threaded){
+        return;
+    }
+
+    wake();
+
+    std::unique_lock<std::mutex> guard(lock);
+
+    wait_changed(guard, [this]{ return (output.size() == 0 && !writing.load()) || output_error.load(); });
+}
+
+void mips_console::io_loop(){
+
+    uint8_t buffer[mips_ring::SIZE];
+
+    while(true){
+
+        //all of the output there is, every time round
+        writing.store(true);
+
+        size_t length = output.pop(buffer, sizeof(buffer));
+
+        for(size_t done = 0; done < length && !output_error.load(); ){
+
+            ssize_t written = write(1, buffer + done, length - done);
+
+            if(written < 0 && errno != EINTR){
+                output_error.store(true); //the program finds out with its next PUTC
+            }
+            else if(written > 0){
+                done += written;
+            }
+        }
+
+        writing.store(false);
+
+        if(length > 0 || output_error.load()){
+            std::lock_guard<std::mutex> guard(lock);
+            changed.notify_all();
+        }
+
+        if(stopping.load() && output.size() == 0){
+            return;
+        }
+
+        sleeping.store(true);
+
+        //anything the program does after these checks gets a wake, so it can't be missed
+        bool want_input = reading.load() && !input_end.load() && !input_error.load() && input.space() > 0;
+
+        if(stopping.load() || output.size() >= mips_ring::SIZE / 2){
+            sleeping.store(false);
+            continue;
+        }
+
+        struct pollfd waiting[2];
+        waiting[0].fd = wake_pipe[0];
+        waiting[0].events = POLLIN;
+        waiting[1].fd = 0;
+        waiting[1].events = POLLIN;
+
+        //output that isn't enough for a wake still goes out within 10 ms
+        int ready = poll(waiting, want_input ? 2 : 1, (output.size() > 0) ? 10 : -1);
+
+        sleeping.store(false);
+
+        if(ready < 0 && errno != EINTR){ //poll() itself doesn't work, so neither side ever will: give up on both rather than spin
+
+            input_error.store(true);
+            output_error.store(true);
+
+            std::lock_guard<std::mutex> guard(lock);
+            changed.notify_all();
+
+            return;
+        }
+
+        if(ready <= 0){ //timed out (or a signal)
+            continue;
+        }
+
+        if(waiting[0].revents & POLLIN){
+
+            char wakes[64];
+            while(read(wake_pipe[0], wakes, sizeof(wakes)) > 0){}
+        }
+
+        if(want_input && (waiting[1].revents & POLLNVAL)){ //stdin is closed: no more input, the same as reading nothing from it
+
+            input_end.store(true);
+
+            std::lock_guard<std::mutex> guard(lock);
+            changed.notify_all();
+        }
+        else if(want_input && (waiting[1].revents & (POLLIN | POLLHUP | POLLERR))){
+
+            ssize_t got = read(0, buffer, input.space());
+
+            if(got > 0){
+                input.push(buffer, got);
+            }
+            else if(got == 0){
+                input_end.store(true);
+            }
+            else if(errno != EINTR && errno != EAGAIN){
+                input_error.store(true);
+            }
+
+            std::lock_guard<std::mutex> guard(lock);
+            changed.notify_all();
+        }
+    }
+}
+
+#else
+
+mips_console::mips_console() : reading(false), input_end(false), input_error(false), output_error(false), writing(false), sleeping(false), stopping(false), put_count(0), threaded(false){
+}
+
+mips_console::~mips_console(){
+
+    std::fflush(stdout);
+}
+
+void mips_console::wake(){
+}
+
+int mips_console::get_wait(){
+
+    return std::getchar();
+}
+
+bool mips_console::put_wait(uint8_t byte){
+
+    return std::putchar(byte) != EOF;
+}
+
+void mips_console::put_check(){
+}
+
+size_t mips_console::get(uint8_t* data, size_t length){
+
+    return std::fread(data, 1, length, stdin);
+}
+
+bool mips_console::put(const uint8_t* data, size_t length){
+
+    return std::fwrite(data, 1, length, stdout) == length;
+}
+
+void mips_console::flush(){
+
+    std::fflush(stdout);
+}
+
+void mips_console::io_loop(){
+}
+
+#endif
+
+mips_console& mips_console_standard(){
+
+    static mips_console console; //its destructor writes out what is left when the process exits
+
+    return console;
+}
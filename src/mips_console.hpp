@@ -0,0 +1,184 @@
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#ifndef MIPS_CONSOLE
+#define MIPS_CONSOLE
+
+//a queue of bytes between one thread putting them in and one taking them out. Each side only moves its own end, so neither needs a lock.
+//each side also keeps the last position of the other end it saw, and only looks at the real one (in the other thread's cache line) when that runs out
+class mips_ring{
+
+    public:
+
+    mips_ring() : tail(0), head_seen(0), head(0), tail_seen(0) {}
+
+    //the producer's side: false / fewer bytes if it is full
+    bool push(uint8_t byte){
+
+        size_t end = tail.load(std::memory_order_relaxed); //only this side writes it
+
+        if(end - head_seen == SIZE){
+
+            head_seen = head.load(std::memory_order_acquire);
+
+            if(end - head_seen == SIZE){
+                return false;
+            }
+        }
+
+        bytes[end & (SIZE - 1)] = byte;
+        tail.store(end + 1, std::memory_order_release); //the byte is there before the consumer can see it
+
+        return true;
+    }
+
+    size_t push(const uint8_t* data, size_t length);
+
+    //the consumer's side: false / fewer bytes if it is empty
+    bool pop(uint8_t& byte){
+
+        size_t start = head.load(std::memory_order_relaxed);
+
+        if(tail_seen == start){
+
+            tail_seen = tail.load(std::memory_order_acquire);
+
+            if(tail_seen == start){
+                return false;
+            }
+        }
+
+        byte = bytes[start & (SIZE - 1)];
+        head.store(start + 1, std::memory_order_release); //read before the producer can write over it
+
+        return true;
+    }
+
+    size_t pop(uint8_t* data, size_t length);
+
+    size_t size() const{ return tail.load(std::memory_order_acquire) - head.load(std::memory_order_acquire); }
+    size_t space() const{ return SIZE - size(); }
+
+    static const size_t SIZE = 0x10000; //a power of 2, so a position is an index with a mask
+
+    private:
+
+    //the producer's
+    alignas(64) std::atomic<size_t> tail; //bytes put in so far, only the producer moves it
+    size_t head_seen;
+
+    //the consumer's
+    alignas(64) std::atomic<size_t> head; //bytes taken out so far, only the consumer moves it
+    size_t tail_seen;
+
+    alignas(64) uint8_t bytes[SIZE];
+};
+
+//stdin and stdout for GETC/PUTC. The program's thread only puts bytes into / takes them out of a ring, an I/O thread of its own
+//writes the output in big writes (once half the ring is full, when the program waits for input, or at least every 10 ms) and reads
+//stdin ahead in big reads once the program starts reading it. The program only waits when it needs input that isn't there yet.
+//one thread at a time can be the program, like one program owns stdin/stdout. Hosts without poll() use getchar/putchar instead
+class mips_console{
+
+    public:
+
+    mips_console();
+
+    //writes what is left of the output and stops the I/O thread
+    ~mips_console();
+
+    //the next byte of stdin, EOF at the end of it (or if reading failed, see input_failed)
+    int get(){
+
+        uint8_t byte;
+
+        return input.pop(byte) ? byte : get_wait();
+    }
+
+    //false if stdout can't be written to any more
+    bool put(uint8_t byte){
+
+        if(!threaded || output_error.load(std::memory_order_relaxed) || !output.push(byte)){
+            return put_wait(byte);
+        }
+
+        if((++put_count & 0xFFF) == 0){ //every 4 KiB, see if there is enough for the I/O thread to write
+            put_check();
+        }
+
+        return true;
+    }
+
+    //get()/put() for a whole buffer at once. get only stops early at the end of stdin, put returns false like the one byte one
+    size_t get(uint8_t* data, size_t length);
+    bool put(const uint8_t* data, size_t length);
+
+    bool input_failed() const{ return input_error.load(); }
+
+    //waits until all the output so far has been written
+    void flush();
+
+    //every console stops waiting for input/output: the program's get/put fail from then on (and its destructor doesn't wait for the output
+    //to be written). For a program that has to stop while stuck in GETC/PUTC. Only sets a flag, so a signal handler can call it
+    static void abandon();
+
+    private:
+
+    void io_loop();
+
+    //get() and put() when the ring is empty/full (or there is no I/O thread)
+    int get_wait();
+    bool put_wait(uint8_t byte);
+    void put_check();
+
+    //gets the I/O thread out of poll(), if it is in it
+    void wake();
+
+    //changed.wait(guard, done), but false once abandon() has been called. Waits 10 ms at a time, so it sees that without a notify
+    template<typename Done>
+    bool wait_changed(std::unique_lock<std::mutex>& guard, Done done){
+
+        while(!changed.wait_for(guard, std::chrono::milliseconds(10), done)){
+
+            if(abandoned.load()){
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static std::atomic<bool> abandoned;
+
+    mips_ring input;
+    mips_ring output;
+
+    std::atomic<bool> reading;      //the program has read stdin, so it gets read ahead from now on
+    std::atomic<bool> input_end;
+    std::atomic<bool> input_error;
+    std::atomic<bool> output_error;
+    std::atomic<bool> writing;      //the I/O thread has output out of the ring that isn't written yet
+    std::atomic<bool> sleeping;     //the I/O thread is (about to be) in poll()
+    std::atomic<bool> stopping;
+
+    size_t put_count; //the program's, to only look at how full the output is now and then
+
+    //only for waiting when a ring is empty/full, the rings themselves don't need it
+    std::mutex lock;
+    std::condition_variable changed;
+
+    int wake_pipe[2];
+    bool threaded; //the I/O thread is running
+
+    std::thread io;
+};
+
+//the console on the process's stdin/stdout, started by the first GETC/PUTC that uses them
+mips_console& mips_console_standard();
+
+#endif
@@ -0,0 +1,158 @@
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+
+#include "mips_devices.hpp"
+#include "mips_memory.hpp"
+#include "mips_timing.hpp"
+
+///////////////////////////////
+///////////// DMA /////////////
+///////////////////////////////
+
+mips_dma_device::mips_dma_device(){
+
+    reset();
+}
+
+void mips_dma_device::reset(){
+
+    address = 0;
+    length = 0;
+    done = 0;
+}
+
+mips_status mips_dma_device::read(mips_memory&, uint32_t offset, uint32_t& data){
+
+    switch(offset){
+
+        case 0x0: data = address; break;
+        case 0x4: data = length; break;
+        case 0xC: data = done; break;
+
+        default: data = 0;
+    }
+
+    return MIPS_OK;
+}
+
+mips_status mips_dma_device::write(mips_memory& memory, uint32_t offset, uint32_t data){
+
+    switch(offset){
+
+        case 0x0: address = data; return MIPS_OK;
+        case 0x4: length = data; return MIPS_OK;
+        case 0xC: return MIPS_MEMORY_TRAP; //read only
+
+        default: break;
+    }
+
+    if(data == 1){ //out
+
+        mips_status status = memory.write_output(address, length);
+
+        done = (status == MIPS_OK) ? length : 0;
+
+        return status;
+    }
+
+    if(data == 2){ //in
+
+        return memory.read_input(address, length, done);
+    }
+
+    return MIPS_MEMORY_TRAP; //no such command
+}
+
+
+///////////////////////////////
+//////////// BLOCK ////////////
+///////////////////////////////
+
+mips_block_device::mips_block_device(std::shared_ptr<const uint8_t> file_in, size_t size_in){
+
+    file = file_in;
+    file_size = size_in;
+
+    reset();
+}
+
+void mips_block_device::reset(){
+
+    position = 0;
+    address = 0;
+    length = 0;
+    done = 0;
+}
+
+mips_status mips_block_device::read(mips_memory&, uint32_t offset, uint32_t& data){
+
+    switch(offset){
+
+        case 0x00: data = (uint32_t)std::min(file_size, (size_t)UINT32_MAX); break;
+        case 0x04: data = position; break;
+        case 0x08: data = address; break;
+        case 0x0C: data = length; break;
+        case 0x14: data = done; break;
+
+        default: data = 0;
+    }
+
+    return MIPS_OK;
+}
+
+mips_status mips_block_device::write(mips_memory& memory, uint32_t offset, uint32_t data){
+
+    switch(offset){
+
+        case 0x04: position = data; return MIPS_OK;
+        case 0x08: address = data; return MIPS_OK;
+        case 0x0C: length = data; return MIPS_OK;
+        case 0x00: //read only
+        case 0x14: return MIPS_MEMORY_TRAP;
+
+        default: break;
+    }
+
+    if(data != 1){
+        return MIPS_MEMORY_TRAP;
+    }
+
+    //what is left of the file from position, if that is less
+    uint32_t copy = (position < file_size) ? (uint32_t)std::min((size_t)length, file_size - position) : 0;
+
+    mips_status status = memory.copy_in_DATA(address, (copy > 0) ? file.get() + position : NULL, copy);
+
+    done = (status == MIPS_OK) ? copy : 0;
+
+    return status;
+}
+
+
+///////////////////////////////
+//////////// CYCLES ///////////
+///////////////////////////////
+
+mips_cycle_device::mips_cycle_device(mips_timing& timing_in){
+
+    timing = &timing_in;
+}
+
+void mips_cycle_device::reset(){
+
+    timing->reset();
+}
+
+mips_status mips_cycle_device::read(mips_memory&, uint32_t offset, uint32_t& data){
+
+    uint64_t cycles = timing->read_cycles();
+
+    data = (offset == 0) ? (uint32_t)cycles : (uint32_t)(cycles >> 32);
+
+    return MIPS_OK;
+}
+
+mips_status mips_cycle_device::write(mips_memory&, uint32_t, uint32_t){
+
+    return MIPS_MEMORY_TRAP; //read only
+}
@@ -0,0 +1,113 @@
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "mips_status.hpp"
+
+#ifndef MIPS_DEVICES
+#define MIPS_DEVICES
+
+class mips_memory;
+class mips_timing;
+
+//a memory mapped device in the I/O page after GETC/PUTC (0x30000008 to 0x30000FFF), see mips_memory::attach_device.
+//it is a few word registers: loads and stores to them (offset from where it is attached, a multiple of 4) come here instead of trapping.
+//a byte/halfword access reads the register and writes it back with the part changed, like anywhere else outside ADDR_DATA
+class mips_device{
+
+    public:
+
+    virtual ~mips_device(){}
+
+    //bytes of registers
+    virtual uint32_t size() const = 0;
+
+    virtual mips_status read(mips_memory& memory, uint32_t offset, uint32_t& data) = 0;
+    virtual mips_status write(mips_memory& memory, uint32_t offset, uint32_t data) = 0;
+
+    //registers back to how they start, for a new run
+    virtual void reset(){}
+};
+
+//moves a whole buffer to PUTC's output, or from GETC's input, with one store.
+//  +0x0 address  the buffer
+//  +0x4 length   its length in bytes
+//  +0x8 command  1 writes the buffer out, 2 reads into it (until it is full or the input ends). Reads as 0
+//  +0xC done     how many bytes the last command moved (read only)
+//a store to a read only register traps. The buffer has to be in ADDR_DATA (or ADDR_INSTR, for writing out), or the command store traps
+class mips_dma_device : public mips_device{
+
+    public:
+
+    mips_dma_device();
+
+    uint32_t size() const{ return 0x10; }
+
+    mips_status read(mips_memory& memory, uint32_t offset, uint32_t& data);
+    mips_status write(mips_memory& memory, uint32_t offset, uint32_t data);
+
+    void reset();
+
+    private:
+
+    uint32_t address;
+    uint32_t length;
+    uint32_t done;
+};
+
+//a host file the program can read in blocks, straight into its memory.
+//  +0x00 size     the size of the file (read only)
+//  +0x04 offset   where in the file to read from
+//  +0x08 address  where in ADDR_DATA to read to
+//  +0x0C length   how many bytes
+//  +0x10 command  1 reads (less past the end of the file). Reads as 0
+//  +0x14 done     how many bytes the last read copied (read only)
+//a store to a read only register traps
+class mips_block_device : public mips_device{
+
+    public:
+
+    //file is size bytes the device only reads (e.g. a file from mips_map_file), shared with anything else using it
+    mips_block_device(std::shared_ptr<const uint8_t> file_in, size_t size_in);
+
+    uint32_t size() const{ return 0x18; }
+
+    mips_status read(mips_memory& memory, uint32_t offset, uint32_t& data);
+    mips_status write(mips_memory& memory, uint32_t offset, uint32_t data);
+
+    void reset();
+
+    private:
+
+    std::shared_ptr<const uint8_t> file;
+    size_t file_size;
+
+    uint32_t position;
+    uint32_t address;
+    uint32_t length;
+    uint32_t done;
+};
+
+//the cycle count of a mips_timing model, for the program to time itself with (see mips_simulator::set_timing).
+//  +0x0 cycles, the low word
+//  +0x4 cycles, the high word (the low one carries into it between two reads, so read high, low, high again if it matters)
+//both read only, a store to them traps. Resetting it resets the model, so a new run starts at cycle 0
+class mips_cycle_device : public mips_device{
+
+    public:
+
+    mips_cycle_device(mips_timing& timing_in);
+
+    uint32_t size() const{ return 0x8; }
+
+    mips_status read(mips_memory& memory, uint32_t offset, uint32_t& data);
+    mips_status write(mips_memory& memory, uint32_t offset, uint32_t data);
+
+    void reset();
+
+    private:
+
+    mips_timing* timing;
+};
+
+#endif
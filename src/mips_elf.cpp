@@ -0,0 +1,152 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "mips_elf.hpp"
+
+//ELF files for MIPS are big endian like everything else the simulator reads, whatever the host is
+static uint32_t elf_word(const uint8_t* at){
+
+    return ((uint32_t)at[0] << 24) | ((uint32_t)at[1] << 16) | ((uint32_t)at[2] << 8) | at[3];
+}
+
+static uint16_t elf_half(const uint8_t* at){
+
+    return ((uint16_t)at[0] << 8) | at[1];
+}
+
+//start and length are from the file, so they can be anything: checked in 64 bits so they can't wrap around
+static bool elf_inside(uint64_t start, uint64_t length, uint64_t region_start, uint64_t region_size){
+
+    return start >= region_start && start + length <= region_start + region_size;
+}
+
+bool elf_is_elf(const uint8_t* file, size_t size){
+
+    return size >= 4 && file[0] == 0x7F && file[1] == 'E' && file[2] == 'L' && file[3] == 'F';
+}
+
+//the functions and objects in the symbol table at header, if it and its strings are inside the file. Anything wrong in it is skipped, it is only extra
+static void elf_symbols(const uint8_t* file, size_t size, const uint8_t* header, const uint8_t* strings_header, std::vector<mips_symbol>& symbols){
+
+    uint32_t offset = elf_word(header + 16);
+    uint32_t length = elf_word(header + 20);
+
+    uint32_t strings_offset = elf_word(strings_header + 16);
+    uint32_t strings_length = elf_word(strings_header + 20);
+
+    if(!elf_inside(offset, length, 0, size) || !elf_inside(strings_offset, strings_length, 0, size)){
+        return;
+    }
+
+    const char* strings = (const char*)file + strings_offset;
+
+    for(uint32_t i = 16; i + 16 <= length; i += 16){ //the first symbol is always the empty one
+
+        const uint8_t* symbol = file + offset + i;
+
+        uint32_t name = elf_word(symbol);
+        uint8_t type = symbol[12] & 0xF;
+
+        if((type != 1 && type != 2) || name >= strings_length){ //only STT_OBJECT and STT_FUNC
+            continue;
+        }
+
+        //the name has to end before the string table does
+        const char* end = (const char*)std::memchr(strings + name, 0, strings_length - name);
+
+        if(end == NULL){
+            continue;
+        }
+
+        mips_symbol entry;
+        entry.name = std::string(strings + name, end);
+        entry.address = elf_word(symbol + 4);
+        entry.size = elf_word(symbol + 8);
+        entry.function = (type == 2);
+
+        symbols.push_back(entry);
+    }
+}
+
+bool elf_parse(const uint8_t* file, size_t size, mips_elf& elf){
+
+    if(size < 52 || !elf_is_elf(file, size)){ //52 is the size of the ELF header
+        return false;
+    }
+
+    //ELFCLASS32, ELFDATA2MSB, an executable (ET_EXEC) for EM_MIPS
+    if(file[4] != 1 || file[5] != 2 || elf_half(file + 16) != 2 || elf_half(file + 18) != 8){
+        return false;
+    }
+
+    elf.entry = elf_word(file + 24);
+    elf.instr.clear();
+    elf.data.clear();
+    elf.symbols.clear();
+
+    uint32_t program_headers = elf_word(file + 28);
+    uint16_t program_header_size = elf_half(file + 42);
+    uint16_t program_header_count = elf_half(file + 44);
+
+    if(program_header_size < 32 || !elf_inside(program_headers, (uint64_t)program_header_size * program_header_count, 0, size)){
+        return false;
+    }
+
+    for(uint16_t i = 0; i < program_header_count; i++){
+
+        const uint8_t* header = file + program_headers + (size_t)i * program_header_size;
+
+        if(elf_word(header) != 1){ //only PT_LOAD gets loaded, the rest (PT_MIPS_REGINFO and the like) is for other tools
+            continue;
+        }
+
+        mips_elf_segment segment;
+        segment.file_offset = elf_word(header + 4);
+        segment.address = elf_word(header + 8);
+        segment.file_size = elf_word(header + 16);
+        segment.memory_size = elf_word(header + 20);
+
+        if(segment.file_size > segment.memory_size || !elf_inside(segment.file_offset, segment.file_size, 0, size)){
+            return false;
+        }
+
+        if(segment.memory_size == 0){
+            continue;
+        }
+
+        if(elf_inside(segment.address, segment.memory_size, 0x10000000, 0x1000000)){
+            elf.instr.push_back(segment);
+        }
+        else if(elf_inside(segment.address, segment.memory_size, 0x20000000, 0x4000000)){
+            elf.data.push_back(segment);
+        }
+        else{
+            return false;
+        }
+    }
+
+    //the symbol table, if there is one. Its strings are in the section its sh_link says
+    uint32_t section_headers = elf_word(file + 32);
+    uint16_t section_header_size = elf_half(file + 46);
+    uint16_t section_header_count = elf_half(file + 48);
+
+    if(section_header_size < 40 || !elf_inside(section_headers, (uint64_t)section_header_size * section_header_count, 0, size)){
+        return true; //no sections is fine, they aren't needed to run
+    }
+
+    for(uint16_t i = 0; i < section_header_count; i++){
+
+        const uint8_t* header = file + section_headers + (size_t)i * section_header_size;
+
+        uint32_t link = elf_word(header + 24);
+
+        if(elf_word(header + 4) == 2 && link < section_header_count){ //SHT_SYMTAB
+            elf_symbols(file, size, header, file + section_headers + (size_t)link * section_header_size, elf.symbols);
+        }
+    }
+
+    return true;
+}
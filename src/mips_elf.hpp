@@ -0,0 +1,47 @@
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#ifndef MIPS_ELF
+#define MIPS_ELF
+
+//reading the .mips.elf files the MIPS toolchain links (see the makefile), so they can run without pulling the .text out into a .bin first.
+//only what the simulator needs: the PT_LOAD segments, the entry point and the symbol table
+
+//one PT_LOAD segment: file_size bytes from file_offset go to address, the rest up to memory_size is 0 (.bss)
+struct mips_elf_segment{
+
+    uint32_t address;
+    uint32_t file_offset;
+    uint32_t file_size;
+    uint32_t memory_size;
+};
+
+//a function or object from the symbol table
+struct mips_symbol{
+
+    std::string name;
+    uint32_t address;
+    uint32_t size;
+    bool function;
+};
+
+struct mips_elf{
+
+    uint32_t entry;
+
+    std::vector<mips_elf_segment> instr; //segments in ADDR_INSTR
+    std::vector<mips_elf_segment> data;  //segments in ADDR_DATA
+
+    std::vector<mips_symbol> symbols; //empty if the file is stripped
+};
+
+//true if the file starts like an ELF file (any ELF file, elf_parse checks the rest)
+bool elf_is_elf(const uint8_t* file, size_t size);
+
+//reads a 32 bit big endian MIPS executable. Returns false if it is anything else, or a segment is not inside the file,
+//or goes anywhere but ADDR_INSTR or ADDR_DATA
+bool elf_parse(const uint8_t* file, size_t size, mips_elf& elf);
+
+#endif
@@ -0,0 +1,723 @@
+#include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <unordered_map>
+
+#include "mips_jit.hpp"
+#include "mips_blocks.hpp"
+
+#if defined(__x86_64__) && defined(__unix__)
+
+#include <sys/mman.h>
+
+///////////////////////////////////////
+////////////// Helpers ////////////////
+///////////////////////////////////////
+
+//what the translated code passes to the helpers it calls (kept in r12)
+struct jit_state{
+
+    const std::vector<mips_decoded>* program;
+    mips_memory* memory;
+    mips_registers* registers;
+
+    uint64_t steps;  //step budget left, every block takes its length off when it starts (and one more for a taken branch's delay slot)
+    uint32_t status; //why the translated code stopped (mips_status), MIPS_OK if it just returned the next PC
+
+    //instruction_execute and instruction_delay_slot for the memory's mode, picked when the run starts
+    mips_status (*execute)(const mips_decoded&, const std::vector<mips_decoded>&, mips_memory&, mips_registers&);
+    mips_status (*delay_slot)(const std::vector<mips_decoded>&, mips_memory&, mips_registers&);
+};
+
+//runs one instruction with the normal handler (loads, stores, HI/LO, ...). The PC it changes is not used, the translated code keeps track of it.
+//the PC is put on the instruction first, so if it traps (or faults in guard page mode) the PC is on it like with the other engines
+//(the traps of the translated instructions themselves store it too, see jit_translator::trap).
+//returns the handler's mips_status, the translated code stops if it isn't MIPS_OK
+static uint32_t jit_execute(jit_state* state, uint32_t index){
+
+    state->registers->next_instruction_branch(0x10000000 + 4 * index);
+
+    return state->execute((*state->program)[index], *state->program, *state->memory, *state->registers);
+}
+
+//jit_execute() for a delay slot: the PC stays on the branch while it runs, as in instruction_delay_slot
+static uint32_t jit_execute_delay_slot(jit_state* state, uint32_t index){
+
+    state->registers->next_instruction_branch(0x10000000 + 4 * (index - 1));
+
+    return state->execute((*state->program)[index], *state->program, *state->memory, *state->registers);
+}
+
+//runs a branch and its delay slot with the normal handlers (used when the delay slot is something the translation can't put inline). Returns the next PC
+static uint32_t jit_branch(jit_state* state, uint32_t index){
+
+    state->registers->next_instruction_branch(0x10000000 + 4 * index);
+
+    state->status = state->execute((*state->program)[index], *state->program, *state->memory, *state->registers);
+
+    if(state->status == MIPS_OK && state->registers->in_delay_slot()){
+
+        state->steps--; //the block made sure there is one left for it
+        state->status = state->delay_slot(*state->program, *state->memory, *state->registers);
+    }
+
+    return state->registers->read_pc();
+}
+
+
+///////////////////////////////////////
+////////////// Emitter ////////////////
+///////////////////////////////////////
+
+//host registers used by the translated code
+enum { EAX = 0, ECX = 1 };
+
+//x86 condition codes (the low 4 bits of jcc)
+enum { CC_O = 0x0, CC_B = 0x2, CC_AE = 0x3, CC_E = 0x4, CC_NE = 0x5, CC_S = 0x8, CC_NS = 0x9, CC_L = 0xC, CC_LE = 0xE, CC_G = 0xF };
+
+//size of the executable buffer. When it is full, blocks that are not translated yet keep being interpreted
+static const size_t JIT_BUFFER_SIZE = 64 * 1024 * 1024;
+
+//how many times a block has to run before it is translated
+static const uint32_t JIT_HOT = 2;
+
+class jit_emitter{
+
+    public:
+
+    uint8_t* buffer;
+    size_t used;
+
+    uint8_t* here(){ return buffer + used; }
+
+    void byte(uint8_t b){ buffer[used++] = b; }
+
+    void dword(uint32_t d){ std::memcpy(buffer + used, &d, 4); used += 4; }
+
+    void qword(uint64_t q){ std::memcpy(buffer + used, &q, 8); used += 8; }
+
+    //mov host, [rbx + 4*guest]
+    void load(int host, uint8_t guest){ byte(0x8B); byte(0x43 | (host << 3)); byte(4 * guest); }
+
+    //mov [rbx + 4*guest], host. Writes to $0 are dropped, just like write_reg
+    void store(int host, uint8_t guest){ if(guest != 0){ byte(0x89); byte(0x43 | (host << 3)); byte(4 * guest); } }
+
+    //mov dword [rbx + 4*guest], value
+    void store_imm(uint8_t guest, uint32_t value){ if(guest != 0){ byte(0xC7); byte(0x43); byte(4 * guest); dword(value); } }
+
+    //mov eax, value
+    void mov_eax(uint32_t value){ byte(0xB8); dword(value); }
+
+    //<op> eax, ecx where op is the x86 opcode (add 01, or 09, and 21, sub 29, xor 31, cmp 39)
+    void alu(uint8_t op){ byte(op); byte(0xC8); }
+
+    //<op> eax, imm32 where op is the short form opcode (add 05, or 0D, and 25, xor 35, cmp 3D)
+    void alu_imm(uint8_t op, uint32_t value){ byte(op); dword(value); }
+
+    //shift eax by a constant, ext is the modrm extension (shl 4, shr 5, sar 7)
+    void shift_imm(int ext, uint8_t amount){ byte(0xC1); byte(0xC0 | (ext << 3)); byte(amount); }
+
+    //shift eax by cl (x86 masks it to 5 bits like MIPS does)
+    void shift_cl(int ext){ byte(0xD3); byte(0xC0 | (ext << 3)); }
+
+    //setcc al; movzx eax, al
+    void set_eax(int cc){ byte(0x0F); byte(0x90 | cc); byte(0xC0); byte(0x0F); byte(0xB6); byte(0xC0); }
+
+    //test eax, eax
+    void test_eax(){ byte(0x85); byte(0xC0); }
+
+    //jcc rel32, returns where the offset is so it can be set later
+    uint8_t* jcc(int cc, uint8_t* target){ byte(0x0F); byte(0x80 | cc); dword(0); uint8_t* site = here() - 4; patch(site, target); return site; }
+
+    //jmp rel32, returns where the offset is
+    uint8_t* jmp(uint8_t* target){ byte(0xE9); dword(0); uint8_t* site = here() - 4; patch(site, target); return site; }
+
+    //points the rel32 at site to target (nothing if target is null)
+    static void patch(uint8_t* site, uint8_t* target){ if(target != NULL){ int32_t offset = target - (site + 4); std::memcpy(site, &offset, 4); } }
+
+    //call function(state, index)
+    void call_helper(void* function, uint32_t index){
+        byte(0x4C); byte(0x89); byte(0xE7); //mov rdi, r12
+        byte(0xBE); dword(index);           //mov esi, index
+        byte(0x48); byte(0xB8); qword((uint64_t)function); //mov rax, function
+        byte(0xFF); byte(0xD0);             //call rax
+    }
+
+    //mov [rsp], eax and mov eax, [rsp] (the spare slot in the frame the entry stub makes)
+    void save_eax(){ byte(0x89); byte(0x04); byte(0x24); }
+    void restore_eax(){ byte(0x8B); byte(0x04); byte(0x24); }
+
+    //mov [r12 + offset], eax (a field of jit_state)
+    void store_state(uint8_t offset){ byte(0x41); byte(0x89); byte(0x44); byte(0x24); byte(offset); }
+
+    //cmp qword [r12 + offset], value, sub qword [r12 + offset], value and add qword [r12 + offset], value
+    void cmp_state(uint8_t offset, uint32_t value){ byte(0x49); byte(0x81); byte(0x7C); byte(0x24); byte(offset); dword(value); }
+    void sub_state(uint8_t offset, uint32_t value){ byte(0x49); byte(0x81); byte(0x6C); byte(0x24); byte(offset); dword(value); }
+    void add_state(uint8_t offset, uint32_t value){ byte(0x49); byte(0x81); byte(0x44); byte(0x24); byte(offset); dword(value); }
+
+    //mov dword [rbx + offset], pc (the PC in mips_registers)
+    void store_pc(uint32_t pc){ byte(0xC7); byte(0x83); dword(mips_registers::pc_offset()); dword(pc); }
+};
+
+
+///////////////////////////////////////
+///////////// Translator //////////////
+///////////////////////////////////////
+
+//enters translated code: entry(registers, state, code) returns the PC to continue from
+typedef uint32_t (*jit_entry)(uint32_t* registers, jit_state* state, uint8_t* code);
+
+class jit_translator{
+
+    public:
+
+    jit_emitter emit;
+
+    jit_entry entry;
+    uint8_t* epilogue;   //returns eax to the dispatcher
+    uint8_t* stop;       //stores eax as the status and returns
+
+    const std::vector<mips_decoded>* program;
+    uint32_t last_index;
+
+    std::vector<uint8_t*> native;  //translated code for the block starting at each instruction, NULL if none
+    std::vector<uint32_t> length;  //steps each translated block can take: its instructions, and a delay slot if it ends with a branch
+    std::vector<uint32_t> heat;    //how many times each block ran before being translated
+    std::unordered_map<uint32_t, std::vector<uint8_t*> > waiting; //jumps to blocks that are not translated yet, by index
+
+    jit_translator() : emit() {}
+    ~jit_translator();
+
+    bool setup(const std::vector<mips_decoded>& program_in, uint32_t last_index_in);
+
+    bool translate(uint32_t index);
+
+    private:
+
+    //a jump out of the block being translated when an instruction in it traps, to its own stub after the block
+    struct trap_site{
+
+        uint8_t* jump;   //the rel32 of the jump to the stub
+        uint32_t pc;     //where the PC goes, MIPS_OK status if the helper that trapped put it there already
+        uint32_t refund; //the steps of the block after the instruction, which didn't run
+        mips_status status;
+    };
+
+    uint32_t block_end; //the last instruction of the block being translated
+    std::vector<trap_site> traps; //its traps, the stubs are emitted after it
+
+    void trap(uint8_t* jump, uint32_t index, bool delay_slot, mips_status status);
+    void trap_stubs();
+    void exit_to(uint32_t pc);
+    bool simple(const mips_decoded& instr);
+    void instruction(const mips_decoded& instr, uint32_t index, bool delay_slot = false);
+    void branch(const mips_decoded& instr, uint32_t index);
+};
+
+jit_translator::~jit_translator(){
+
+    if(emit.buffer != NULL){
+        munmap(emit.buffer, JIT_BUFFER_SIZE);
+    }
+}
+
+bool jit_translator::setup(const std::vector<mips_decoded>& program_in, uint32_t last_index_in){
+
+    void* memory = mmap(NULL, JIT_BUFFER_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if(memory == MAP_FAILED){
+        return false;
+    }
+
+    emit.buffer = (uint8_t*)memory;
+    emit.used = 0;
+
+    program = &program_in;
+    last_index = last_index_in;
+    native.assign(last_index + 1, NULL);
+    length.assign(last_index + 1, 0);
+    heat.assign(last_index + 1, 0);
+
+    //entry stub: keeps rbx/r12, leaves an aligned frame with one spare slot at [rsp], then jumps to the block
+    entry = (jit_entry)emit.here();
+    emit.byte(0x53);                                    //push rbx
+    emit.byte(0x41); emit.byte(0x54);                   //push r12
+    emit.byte(0x48); emit.byte(0x83); emit.byte(0xEC); emit.byte(0x08); //sub rsp, 8
+    emit.byte(0x48); emit.byte(0x89); emit.byte(0xFB);  //mov rbx, rdi
+    emit.byte(0x49); emit.byte(0x89); emit.byte(0xF4);  //mov r12, rsi
+    emit.byte(0xFF); emit.byte(0xE2);                   //jmp rdx
+
+    epilogue = emit.here();
+    emit.byte(0x48); emit.byte(0x83); emit.byte(0xC4); emit.byte(0x08); //add rsp, 8
+    emit.byte(0x41); emit.byte(0x5C);                   //pop r12
+    emit.byte(0x5B);                                    //pop rbx
+    emit.byte(0xC3);                                    //ret
+
+    stop = emit.here();
+    emit.store_state(offsetof(jit_state, status));
+    emit.jmp(epilogue);
+
+    return true;
+}
+
+//jump (the rel32 of a jcc/jmp just emitted) stops the block with status for the instruction at index: the PC goes on it (on the branch, for a delay slot,
+//as in instruction_delay_slot) and the block's steps after it are given back, so a trap leaves the same PC and budget as in the other engines.
+//MIPS_OK is for a helper that trapped: the PC and status are there already, only the steps are given back
+void jit_translator::trap(uint8_t* jump, uint32_t index, bool delay_slot, mips_status status){
+
+    trap_site site;
+    site.jump = jump;
+    site.pc = 0x10000000 + 4 * (delay_slot ? index - 1 : index);
+    site.refund = (delay_slot || index >= block_end) ? 0 : block_end - index;
+    site.status = status;
+
+    if(site.status == MIPS_OK && site.refund == 0){ //nothing for a stub to do
+        jit_emitter::patch(jump, stop);
+        return;
+    }
+
+    traps.push_back(site);
+}
+
+//the stubs of the block's traps, each one only does what its trap needs
+void jit_translator::trap_stubs(){
+
+    for(size_t i = 0; i < traps.size(); i++){
+
+        const trap_site& site = traps[i];
+
+        jit_emitter::patch(site.jump, emit.here());
+
+        if(site.refund > 0){
+            emit.add_state(offsetof(jit_state, steps), site.refund);
+        }
+
+        if(site.status != MIPS_OK){
+            emit.store_pc(site.pc);
+            emit.mov_eax(site.status);
+        }
+
+        emit.jmp(stop);
+    }
+
+    traps.clear();
+}
+
+//leaves the block to a known address. Goes straight to its code if it is translated, otherwise back to the dispatcher (and gets linked later)
+void jit_translator::exit_to(uint32_t pc){
+
+    uint32_t index = (pc - 0x10000000) / 4;
+    bool inside = pc >= 0x10000000 && index <= last_index;
+
+    if(inside && native[index] != NULL){
+        emit.jmp(native[index]);
+        return;
+    }
+
+    emit.mov_eax(pc);
+    uint8_t* site = emit.jmp(epilogue);
+
+    if(inside){
+        waiting[index].push_back(site);
+    }
+}
+
+//instructions that can go inline (everything except branches/jumps, which change the PC)
+bool jit_translator::simple(const mips_decoded& instr){
+
+    return !instruction_is_branch(instr.handler);
+}
+
+//translates one instruction that is not a branch
+void jit_translator::instruction(const mips_decoded& instr, uint32_t index, bool delay_slot){
+
+    uint8_t rs = instr.rs;
+    uint8_t rt = instr.rt;
+    uint8_t rd = instr.rd;
+    uint32_t immediate = instr.immediate;
+
+    switch(instr.handler){
+
+        case OP_ADDU: emit.load(EAX, rs); emit.load(ECX, rt); emit.alu(0x01); emit.store(EAX, rd); break;
+        case OP_SUBU: emit.load(EAX, rs); emit.load(ECX, rt); emit.alu(0x29); emit.store(EAX, rd); break;
+        case OP_AND:  emit.load(EAX, rs); emit.load(ECX, rt); emit.alu(0x21); emit.store(EAX, rd); break;
+        case OP_OR:   emit.load(EAX, rs); emit.load(ECX, rt); emit.alu(0x09); emit.store(EAX, rd); break;
+        case OP_XOR:  emit.load(EAX, rs); emit.load(ECX, rt); emit.alu(0x31); emit.store(EAX, rd); break;
+
+        //overflow exits with -10 before rd is written
+        case OP_ADD:
+            emit.load(EAX, rs); emit.load(ECX, rt); emit.alu(0x01); trap(emit.jcc(CC_O, NULL), index, delay_slot, MIPS_ARITHMETIC_TRAP); emit.store(EAX, rd);
+            break;
+        case OP_SUB:
+            emit.load(EAX, rs); emit.load(ECX, rt); emit.alu(0x29); trap(emit.jcc(CC_O, NULL), index, delay_slot, MIPS_ARITHMETIC_TRAP); emit.store(EAX, rd);
+            break;
+
+        case OP_SLT:  emit.load(EAX, rs); emit.load(ECX, rt); emit.alu(0x39); emit.set_eax(CC_L); emit.store(EAX, rd); break;
+        case OP_SLTU: emit.load(EAX, rs); emit.load(ECX, rt); emit.alu(0x39); emit.set_eax(CC_B); emit.store(EAX, rd); break;
+
+        case OP_SLL: emit.load(EAX, rt); emit.shift_imm(4, immediate); emit.store(EAX, rd); break;
+        case OP_SRL: emit.load(EAX, rt); emit.shift_imm(5, immediate); emit.store(EAX, rd); break;
+        case OP_SRA: emit.load(EAX, rt); emit.shift_imm(7, immediate); emit.store(EAX, rd); break;
+
+        case OP_SLLV: emit.load(EAX, rt); emit.load(ECX, rs); emit.shift_cl(4); emit.store(EAX, rd); break;
+        case OP_SRLV: emit.load(EAX, rt); emit.load(ECX, rs); emit.shift_cl(5); emit.store(EAX, rd); break;
+        case OP_SRAV: emit.load(EAX, rt); emit.load(ECX, rs); emit.shift_cl(7); emit.store(EAX, rd); break;
+
+        case OP_LUI: emit.store_imm(rt, immediate); break;
+
+        case OP_ADDIU: emit.load(EAX, rs); emit.alu_imm(0x05, immediate); emit.store(EAX, rt); break;
+        case OP_ADDI:
+            emit.load(EAX, rs); emit.alu_imm(0x05, immediate); trap(emit.jcc(CC_O, NULL), index, delay_slot, MIPS_ARITHMETIC_TRAP); emit.store(EAX, rt);
+            break;
+        case OP_ANDI:  emit.load(EAX, rs); emit.alu_imm(0x25, immediate); emit.store(EAX, rt); break;
+        case OP_ORI:   emit.load(EAX, rs); emit.alu_imm(0x0D, immediate); emit.store(EAX, rt); break;
+        case OP_XORI:  emit.load(EAX, rs); emit.alu_imm(0x35, immediate); emit.store(EAX, rt); break;
+
+        case OP_SLTI:  emit.load(EAX, rs); emit.alu_imm(0x3D, immediate); emit.set_eax(CC_L); emit.store(EAX, rt); break;
+        case OP_SLTIU: emit.load(EAX, rs); emit.alu_imm(0x3D, immediate); emit.set_eax(CC_B); emit.store(EAX, rt); break;
+
+        case OP_INVALID: trap(emit.jmp(NULL), index, delay_slot, MIPS_INVALID_INSTRUCTION); break;
+
+        //loads, stores, multiply/divide and HI/LO go through the normal handler, so the memory checks and exit codes stay the same
+        default:
+            emit.call_helper(delay_slot ? (void*)&jit_execute_delay_slot : (void*)&jit_execute, index);
+            emit.test_eax();
+            trap(emit.jcc(CC_NE, NULL), index, delay_slot, MIPS_OK);
+            break;
+    }
+}
+
+//translates the branch/jump at the end of a block, including its delay slot
+void jit_translator::branch(const mips_decoded& instr, uint32_t index){
+
+    uint32_t pc = 0x10000000 + 4 * index;
+    bool delay_slot = index < last_index; //same as "PC < LAST_INSTR_ADDRESS" in the handlers
+
+    //a delay slot that is itself a branch is an invalid instruction when the first one is taken, so let the handlers do the whole thing.
+    //it sets the status itself, the dispatcher checks it
+    if(delay_slot && !simple((*program)[index + 1])){
+        emit.call_helper((void*)&jit_branch, index);
+        emit.jmp(epilogue);
+        return;
+    }
+
+    uint8_t* not_taken = NULL; //jump to the not taken exit, for conditional branches
+    bool register_target = false; //JR/JALR: the target is kept at [rsp] while the delay slot runs
+
+    switch(instr.handler){
+
+        case OP_BEQ: emit.load(EAX, instr.rs); emit.load(ECX, instr.rt); emit.alu(0x39); not_taken = emit.jcc(CC_NE, NULL); break;
+        case OP_BNE: emit.load(EAX, instr.rs); emit.load(ECX, instr.rt); emit.alu(0x39); not_taken = emit.jcc(CC_E, NULL); break;
+
+        case OP_BGEZ: emit.load(EAX, instr.rs); emit.test_eax(); not_taken = emit.jcc(CC_S, NULL); break;
+        case OP_BLTZ: emit.load(EAX, instr.rs); emit.test_eax(); not_taken = emit.jcc(CC_NS, NULL); break;
+        case OP_BGTZ: emit.load(EAX, instr.rs); emit.test_eax(); not_taken = emit.jcc(CC_LE, NULL); break;
+        case OP_BLEZ: emit.load(EAX, instr.rs); emit.test_eax(); not_taken = emit.jcc(CC_G, NULL); break;
+
+        //the link is written before rs is read, like the handlers do
+        case OP_BGEZAL: emit.store_imm(31, pc + 8); emit.load(EAX, instr.rs); emit.test_eax(); not_taken = emit.jcc(CC_S, NULL); break;
+        case OP_BLTZAL: emit.store_imm(31, pc + 8); emit.load(EAX, instr.rs); emit.test_eax(); not_taken = emit.jcc(CC_NS, NULL); break;
+
+        case OP_J: break;
+        case OP_JAL: emit.store_imm(31, pc + 8); break;
+
+        //rs is read before rd is written (for JALR), and a target that isn't alligned exits before the delay slot
+        case OP_JR:
+        case OP_JALR:
+            emit.load(EAX, instr.rs);
+            if(instr.handler == OP_JALR){
+                emit.store_imm(instr.rd, pc + 8);
+            }
+            emit.alu_imm(0xA9, 3); //test eax, 3
+            trap(emit.jcc(CC_NE, NULL), index, false, MIPS_MEMORY_TRAP);
+            emit.save_eax();
+            register_target = true;
+            break;
+    }
+
+    //taken: the delay slot is a step of its own (even past the end of the binary, where there is nothing to run), as in instruction_delay_slot
+    emit.sub_state(offsetof(jit_state, steps), 1);
+
+    if(delay_slot){
+        instruction((*program)[index + 1], index + 1, true);
+    }
+
+    if(register_target){
+        //back to the dispatcher, which exits for 0 and out of range addresses
+        emit.restore_eax();
+        emit.jmp(epilogue);
+    }
+    else if(instr.handler == OP_J || instr.handler == OP_JAL){
+        exit_to(instr.immediate | (pc & 0xF0000000));
+    }
+    else{
+        exit_to(pc + instr.immediate);
+    }
+
+    if(not_taken != NULL){
+        jit_emitter::patch(not_taken, emit.here());
+        exit_to(pc + 4);
+    }
+}
+
+//translates the block starting at index. Returns false if the buffer is full
+bool jit_translator::translate(uint32_t index){
+
+    //find the end of the block: a branch/jump, an invalid instruction or the end of the binary
+    uint32_t end = index;
+
+    while(end < last_index && (*program)[end].handler != OP_INVALID && !instruction_is_branch((*program)[end].handler)){
+        end++;
+    }
+
+    //no instruction takes more than 64 bytes with its trap stub, with room for the exits and delay slot
+    if(emit.used + 64 * (end - index + 8) > JIT_BUFFER_SIZE){
+        return false;
+    }
+
+    uint8_t* start = emit.here();
+    block_end = end;
+
+    //a block that ends with a branch may need one more step for the delay slot
+    uint32_t budget = end - index + 1;
+
+    if(instruction_is_branch((*program)[end].handler)){
+        budget++;
+    }
+
+    //take the block off the step budget, or go back to the dispatcher (which runs it one instruction at a time) if there isn't enough left
+    emit.cmp_state(offsetof(jit_state, steps), budget);
+    uint8_t* enough = emit.jcc(CC_AE, NULL);
+    emit.mov_eax(0x10000000 + 4 * index);
+    emit.jmp(epilogue);
+    jit_emitter::patch(enough, emit.here());
+    emit.sub_state(offsetof(jit_state, steps), end - index + 1);
+
+    for(uint32_t i = index; i <= end; i++){
+
+        const mips_decoded& instr = (*program)[i];
+
+        if(instruction_is_branch(instr.handler)){
+            branch(instr, i);
+        }
+        else{
+            instruction(instr, i);
+        }
+    }
+
+    //ran off the end of the binary without a branch: the dispatcher exits with -11
+    const mips_decoded& last = (*program)[end];
+
+    if(last.handler != OP_INVALID && !instruction_is_branch(last.handler)){
+        exit_to(0x10000000 + 4 * (end + 1));
+    }
+
+    trap_stubs();
+
+    native[index] = start;
+    length[index] = budget;
+
+    //link the blocks that were waiting for this one
+    std::unordered_map<uint32_t, std::vector<uint8_t*> >::iterator waiting_here = waiting.find(index);
+
+    if(waiting_here != waiting.end()){
+
+        for(size_t i = 0; i < waiting_here->second.size(); i++){
+            jit_emitter::patch(waiting_here->second[i], start);
+        }
+
+        waiting.erase(waiting_here);
+    }
+
+    return true;
+}
+
+
+///////////////////////////////////////
+///////////// Dispatcher //////////////
+///////////////////////////////////////
+
+mips_jit::mips_jit(){
+
+    translator = NULL;
+    unavailable = false;
+}
+
+mips_jit::~mips_jit(){
+
+    delete translator;
+}
+
+void mips_jit::clear(){
+
+    delete translator;
+    translator = NULL;
+    unavailable = false;
+
+    fallback.clear();
+}
+
+mips_status mips_jit::run(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps){
+
+    if(unavailable){
+        return fallback.run(program, memory, registers, steps);
+    }
+
+    jit_state state;
+    state.program = &program;
+    state.memory = &memory;
+    state.registers = &registers;
+
+    //the memory mode doesn't change during a run, so it is only looked at here
+    if(memory.guard_pages()){
+        state.execute = instruction_execute<mips_memory_guarded>;
+        state.delay_slot = instruction_delay_slot<mips_memory_guarded>;
+    }
+    else{
+        state.execute = instruction_execute<mips_memory_paged>;
+        state.delay_slot = instruction_delay_slot<mips_memory_paged>;
+    }
+
+    //the last run stopped between a branch and its delay slot
+    if(registers.in_delay_slot()){
+
+        if(steps == 0){
+            return MIPS_STEP_LIMIT;
+        }
+        steps--;
+
+        mips_status status = state.delay_slot(program, memory, registers);
+
+        if(status != MIPS_OK){
+            return status;
+        }
+    }
+
+    uint32_t last_address = memory.read_LAST_INSTR_ADDRESS();
+    uint32_t pc = registers.read_pc();
+
+    if(pc < 0x10000000 || pc > last_address){
+        return MIPS_MEMORY_TRAP;
+    }
+
+    uint32_t last_index = (last_address - 0x10000000) / 4;
+
+    if(translator == NULL){
+
+        translator = new jit_translator;
+
+        if(!translator->setup(program, last_index)){
+
+            delete translator;
+            translator = NULL;
+            unavailable = true;
+
+            return fallback.run(program, memory, registers, steps);
+        }
+    }
+
+    state.steps = steps;
+
+    mips_status status = MIPS_OK;
+
+    while(status == MIPS_OK){
+
+        //the PC is kept up to date between blocks, so a run that stops can be continued
+        registers.next_instruction_branch(pc);
+
+        //if the address points at 0x0, which means the program has finished execution, stop and indicate success
+        if(pc == 0){
+            status = MIPS_EXITED;
+            break;
+        }
+
+        //if the PC is outside of the binary, stop and indicate memory error
+        if(pc < 0x10000000 || pc > last_address){
+            status = MIPS_MEMORY_TRAP;
+            break;
+        }
+
+        uint32_t index = (pc - 0x10000000) / 4;
+
+        if(translator->native[index] == NULL && translator->heat[index] < JIT_HOT){
+
+            translator->heat[index]++;
+
+            if(translator->heat[index] == JIT_HOT && !translator->translate(index)){
+                translator->heat[index] = JIT_HOT + 1; //buffer is full, keep interpreting it
+            }
+        }
+
+        if(translator->native[index] != NULL && state.steps >= translator->length[index]){
+
+            state.status = MIPS_OK;
+
+            pc = translator->entry(registers.reg_pointer(), &state, translator->native[index]);
+
+            status = (mips_status)state.status;
+        }
+        else{
+
+            //not hot yet, or not enough steps left for all of it: interpret the block
+            for(uint32_t i = index; ; i++){
+
+                if(state.steps == 0){
+                    status = MIPS_STEP_LIMIT;
+                    break;
+                }
+
+                state.steps--;
+
+                status = state.execute(program[i], program, memory, registers);
+
+                if(status != MIPS_OK || i == last_index || program[i].handler == OP_INVALID || instruction_is_branch(program[i].handler)){
+                    break;
+                }
+            }
+
+            //a taken branch left its delay slot to run
+            if(status == MIPS_OK && registers.in_delay_slot()){
+
+                if(state.steps == 0){
+                    status = MIPS_STEP_LIMIT;
+                }
+                else{
+                    state.steps--;
+                    status = state.delay_slot(program, memory, registers);
+                }
+            }
+
+            pc = registers.read_pc();
+        }
+    }
+
+    steps = state.steps;
+
+    return status;
+}
+
+#else
+
+mips_jit::mips_jit(){
+
+    translator = NULL;
+    unavailable = true;
+}
+
+mips_jit::~mips_jit(){
+}
+
+void mips_jit::clear(){
+
+    fallback.clear();
+}
+
+mips_status mips_jit::run(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps){
+
+    //no translator for this host
+    return fallback.run(program, memory, registers, steps);
+}
+
+#endif
@@ -0,0 +1,43 @@
+#include <cstdint>
+#include <vector>
+
+#include "mips_memory.hpp"
+#include "mips_registers.hpp"
+#include "mips_breakdown.hpp"
+#include "mips_blocks.hpp"
+
+#ifndef MIPS_JIT
+#define MIPS_JIT
+
+class jit_translator;
+
+//runs the program translating hot basic blocks into x86-64 code.
+//the translated blocks work on the register array of mips_registers directly, jump straight to each other once both are translated,
+//and call back into the normal handlers for loads, stores, HI/LO and anything they don't translate, so the results (and statuses) are the same.
+//on other hosts, or if no executable memory can be allocated, it just runs the block engine.
+class mips_jit{
+
+    public:
+
+    mips_jit();
+    ~mips_jit();
+
+    //forgets all translated code (needed when a different binary gets loaded)
+    void clear();
+
+    //runs from the current PC until the program stops or steps instructions have run, same as program_run_table.
+    //every translated block checks the budget once when it starts
+    mips_status run(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers, uint64_t& steps);
+
+    private:
+
+    mips_jit(const mips_jit&) = delete; //owns the executable buffer
+    mips_jit& operator=(const mips_jit&) = delete;
+
+    jit_translator* translator; //made on the first run, NULL until then
+    bool unavailable; //no translator for this host, or no executable memory
+
+    mips_block_engine fallback;
+};
+
+#endif
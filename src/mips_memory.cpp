@@ -2,33 +2,323 @@
 #include <iostream>
 #include <cstdint>
 #include <vector>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
 
 #include "mips_memory.hpp"
+#include "mips_console.hpp"
+#include "mips_devices.hpp"
+
+#ifdef MIPS_GUARD_PAGES
+#include <signal.h>
+#endif
+
+#if defined(__unix__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+//a big endian word at bytes: one host load, and a byte swap on little endian hosts
+static inline uint32_t load_big_endian(const uint8_t* bytes){
+
+    uint32_t word;
+    std::memcpy(&word, bytes, 4);
+
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    return __builtin_bswap32(word);
+#elif defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    return word;
+#else
+    return (uint32_t)bytes[0] << 24 | (uint32_t)bytes[1] << 16 | (uint32_t)bytes[2] << 8 | bytes[3];
+#endif
+}
+
+static inline void store_big_endian(uint8_t* bytes, uint32_t word){
+
+#if defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    word = __builtin_bswap32(word);
+    std::memcpy(bytes, &word, 4);
+#elif defined(__GNUC__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    std::memcpy(bytes, &word, 4);
+#else
+    bytes[0] = word >> 24;
+    bytes[1] = word >> 16;
+    bytes[2] = word >> 8;
+    bytes[3] = word;
+#endif
+}
 
 
 // constructor:   initialises the memory:
 
 mips_memory::mips_memory(){
 
-    ADDR_INSTR.resize(0x1000000);
+    //ADDR_DATA starts without any pages, they get allocated when something is written to them
+    ADDR_INSTR = NULL;
+
+    INSTR_SIZE = 0;
+    LAST_INSTR_ADDRESS = 0x10000000 - 4;
+
+    input = NULL;
+    input_position = 0;
+    output = NULL;
 
-    ADDR_DATA.resize(0x4000000);
+    guard = NULL;
+
+    attach_device(0x30000010, std::unique_ptr<mips_device>(new mips_dma_device()));
 
     //once we got flags and stuff we can add them here to initialise the value if needed
 }
 
-void mips_memory::copy_ADDR_INSTR(char* source){
+mips_memory::~mips_memory(){
 
-    for (int i = 0; i < INSTR_SIZE; i++){
-    
-    // TEST //// std::cerr << "the " << i << "th char is" << source[i] << std::endl;
-    ADDR_INSTR[i] = source[i]; 
-    
-    //each element is a char which corresponds to a byte
-    }    
+    set_guard_pages(false);
+}
+
+
+///////////////////////////////
+//////// GUARD PAGES //////////
+///////////////////////////////
+
+#ifdef MIPS_GUARD_PAGES
+
+static const uint64_t GUARD_SIZE = 0x100000000ull; //all of the 32 bit address space
+
+//the run going on in this thread: where its reservation is and where a fault in it jumps to
+static thread_local sigjmp_buf* guard_fault = NULL;
+static thread_local const uint8_t* guard_base = NULL;
+
+static struct sigaction guard_previous; //the SIGSEGV handler from before ours, for faults that aren't a MIPS access
+static std::once_flag guard_installed;
+
+static void guard_handler(int, siginfo_t* info, void*){
+
+    const uint8_t* address = (const uint8_t*)info->si_addr;
+
+    if(guard_fault != NULL && address >= guard_base && address < guard_base + GUARD_SIZE){ //a load or store outside ADDR_INSTR/ADDR_DATA
+        siglongjmp(*guard_fault, 1);
+    }
+
+    //a real crash: give it back to the old handler, the instruction faults again when this returns
+    sigaction(SIGSEGV, &guard_previous, NULL);
+}
+
+static void guard_install(){
+
+    struct sigaction action;
+    action.sa_sigaction = guard_handler;
+    action.sa_flags = SA_SIGINFO;
+    sigemptyset(&action.sa_mask);
+
+    sigaction(SIGSEGV, &action, &guard_previous);
+}
+
+bool mips_memory::set_guard_pages(bool on){
+
+    if(on == (guard != NULL)){
+        return true;
+    }
+
+    clear_DATA();
+
+    if(!on){
+
+        munmap(guard, GUARD_SIZE);
+        guard = NULL;
+
+        clear_DATA(); //again, so the DATA_IMAGE is in the pages now
+
+        return true;
+    }
+
+    //nothing is committed until it is touched: ADDR_DATA reads as 0 and only the pages written get memory
+    void* reservation = mmap(NULL, GUARD_SIZE, PROT_NONE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+
+    if(reservation == MAP_FAILED){
+        return false;
+    }
+
+    uint8_t* base = (uint8_t*)reservation;
+
+    if(mprotect(base + 0x10000000, 0x1000000, PROT_READ) != 0 || mprotect(base + 0x20000000, 0x4000000, PROT_READ | PROT_WRITE) != 0){
+
+        munmap(reservation, GUARD_SIZE);
+        return false;
+    }
+
+    std::call_once(guard_installed, guard_install);
+
+    guard = base;
+    guard_copy_INSTR();
+
+    clear_DATA(); //frees the pages, and puts the DATA_IMAGE in the reservation
+
+    return true;
+}
+
+void mips_memory::guard_copy_INSTR(){
+
+    madvise(guard + 0x10000000, 0x1000000, MADV_DONTNEED); //back to zeros
+
+    if(INSTR_SIZE > 0){
+
+        mprotect(guard + 0x10000000, 0x1000000, PROT_READ | PROT_WRITE);
+        std::memcpy(guard + 0x10000000, ADDR_INSTR.get(), INSTR_SIZE);
+        mprotect(guard + 0x10000000, 0x1000000, PROT_READ);
+    }
+}
 
-    LAST_INSTR_ADDRESS = INSTR_SIZE + 0x10000000 - 4;  
+void mips_guard_enter(const mips_memory& memory, sigjmp_buf* fault){
 
+    guard_base = memory.guard;
+    guard_fault = fault;
+}
+
+void mips_guard_leave(){
+
+    guard_fault = NULL;
+    guard_base = NULL;
+}
+
+#else
+
+bool mips_memory::set_guard_pages(bool on){
+
+    return !on; //always paged
+}
+
+void mips_memory::guard_copy_INSTR(){
+}
+
+void mips_guard_enter(const mips_memory&, sigjmp_buf*){
+}
+
+void mips_guard_leave(){
+}
+
+#endif
+
+bool mips_memory::guard_pages() const{
+
+    return guard != NULL;
+}
+
+void mips_memory::copy_ADDR_INSTR(const char* source){
+
+    //a new copy every time, another memory may still be sharing the old one
+    uint8_t* copy = new uint8_t[INSTR_SIZE];
+    std::copy(source, source + INSTR_SIZE, copy); //each element is a char which corresponds to a byte
+
+    set_ADDR_INSTR(std::shared_ptr<const uint8_t>(copy, std::default_delete<const uint8_t[]>()), INSTR_SIZE);
+}
+
+bool mips_map_file(const std::string& location, std::shared_ptr<const uint8_t>& data, size_t& size){
+
+#if defined(__unix__)
+
+    int file = open(location.c_str(), O_RDONLY);
+
+    if(file < 0){
+        return false;
+    }
+
+    struct stat info;
+
+    if(fstat(file, &info) != 0){
+        close(file);
+        return false;
+    }
+
+    size_t length = info.st_size;
+    std::shared_ptr<const uint8_t> mapped;
+
+    if(length > 0){ //mmap can't map nothing
+
+        void* mapping = mmap(NULL, length, PROT_READ, MAP_PRIVATE, file, 0);
+
+        if(mapping == MAP_FAILED){ //not a file that can be mapped (a directory, a pipe, ...)
+            close(file);
+            return false;
+        }
+
+        mapped = std::shared_ptr<const uint8_t>((const uint8_t*)mapping, [length](const uint8_t* start){ munmap((void*)start, length); });
+    }
+
+    close(file); //the mapping stays
+
+    data = mapped;
+    size = length;
+
+    return true;
+
+#else
+
+    std::ifstream file(location, std::ios::binary | std::ios::ate); //the "ate" flag makes the pointer point to the end of the file, so tellg() shows the size of the file
+
+    if(!file.is_open()){
+        return false;
+    }
+
+    std::streampos file_size = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    if(file_size < 0){
+        return false;
+    }
+
+    uint8_t* buffer = new uint8_t[file_size];
+
+    file.read((char*)buffer, file_size);
+
+    data = std::shared_ptr<const uint8_t>(buffer, std::default_delete<const uint8_t[]>());
+    size = file_size;
+
+    return true;
+
+#endif
+}
+
+void mips_memory::set_ADDR_INSTR(std::shared_ptr<const uint8_t> image, int size){
+
+    ADDR_INSTR = image;
+    INSTR_SIZE = size;
+    LAST_INSTR_ADDRESS = INSTR_SIZE + 0x10000000 - 4;
+
+    DATA_IMAGE = NULL;
+
+    if(guard != NULL){
+        guard_copy_INSTR();
+    }
+}
+
+void mips_memory::add_DATA_IMAGE(const mips_data_segment& segment){
+
+    //other memories may share the old one
+    std::shared_ptr<std::vector<mips_data_segment> > image = (DATA_IMAGE != NULL) ? std::make_shared<std::vector<mips_data_segment> >(*DATA_IMAGE) : std::make_shared<std::vector<mips_data_segment> >();
+
+    image->push_back(segment);
+
+    DATA_IMAGE = image;
+}
+
+void mips_memory::share_ADDR_INSTR(const mips_memory& source){
+
+    ADDR_INSTR = source.ADDR_INSTR;
+    INSTR_SIZE = source.INSTR_SIZE;
+    LAST_INSTR_ADDRESS = source.LAST_INSTR_ADDRESS;
+
+    DATA_IMAGE = source.DATA_IMAGE;
+
+    if(guard != NULL){ //every reservation needs its own copy for the loads
+        guard_copy_INSTR();
+    }
 }
 
 void mips_memory::set_INSTR_SIZE(int file_size){
@@ -36,107 +326,770 @@ void mips_memory::set_INSTR_SIZE(int file_size){
     INSTR_SIZE = file_size;
 }
 
+const mips_data_page* mips_memory::data_page(uint32_t offset) const{
+
+    const mips_data_table* table = ADDR_DATA[offset >> 20].get();
+
+    if(table == NULL){
+        return NULL;
+    }
+
+    return table->pages[(offset >> 12) & 0xFF].get();
+}
+
+mips_data_page* mips_memory::data_page_write(uint32_t offset){
+
+    std::unique_ptr<mips_data_table>& table = ADDR_DATA[offset >> 20];
+
+    if(!table){
+        table.reset(new mips_data_table());
+    }
+
+    uint32_t number = (offset >> 12) & 0xFF;
+
+    std::shared_ptr<mips_data_page>& page = table->pages[number];
+
+    if(!page){
+        page = std::make_shared<mips_data_page>(); //value initialised, so it starts as zeros
+        dirty.push_back(offset >> 12);
+    }
+    else if(page.use_count() != 1 || table->borrowed[number]){ //a snapshot has it too (it keeps the old one), or it isn't ours to write
+        page = std::make_shared<mips_data_page>(*page);
+        table->borrowed[number] = false;
+        dirty.push_back(offset >> 12);
+    }
+
+    return page.get();
+}
+
 uint32_t mips_memory::read_INSTR(int memory_location){ //the index is the offset memory (to get it from original memory location, subtract 0x10000000)
 
-    uint32_t INSTR;
+    uint32_t INSTR = 0;
 
     int index = memory_location - 0x10000000; //double check the amount
 
-    INSTR = ADDR_INSTR[index];
+    const uint8_t* image = ADDR_INSTR.get();
+
+    if(index >= 0 && index + 4 <= INSTR_SIZE){ //the whole word is in the binary
+        return load_big_endian(&image[index]);
+    }
+
+    for(int i = index; i < index + 4; i++){
 
-    INSTR = INSTR << 8 | ADDR_INSTR[index+1];
-    INSTR = INSTR << 8 | ADDR_INSTR[index+2];
-    INSTR = INSTR << 8 | ADDR_INSTR[index+3];
+        INSTR = INSTR << 8 | ((i >= 0 && i < INSTR_SIZE) ? image[i] : 0); //past the end of the binary is 0
+    }
 
     return INSTR;   
 }
 
-uint32_t mips_memory::read_DATA(int memory_location){ //the index is the offset memory (to get it from original memory location, subtract 0x20000000)
+mips_status mips_memory::read_DATA(int memory_location, uint32_t& data){ //the index is the offset memory (to get it from original memory location, subtract 0x20000000)
 
     if((memory_location & 0b11) != 0){ //not alligned
-        exit(-11);
+        return MIPS_MEMORY_TRAP;
     }
 
     uint32_t DATA;
 
     if(memory_location < 0x24000000 && memory_location >= 0x20000000){ //if it is in ADDR_DATA area
-        int index = memory_location - 0x20000000; // double check the amount
+        uint32_t index = memory_location - 0x20000000; // double check the amount
+
+        const mips_data_page* page = data_page(index);
 
-        DATA = ADDR_DATA[index];
+        if(page == NULL){ //nothing written to this page yet
+            DATA = 0;
+        }
+        else{
 
-        DATA = DATA << 8 | ADDR_DATA[index+1];
-        DATA = DATA << 8 | ADDR_DATA[index+2];
-        DATA = DATA << 8 | ADDR_DATA[index+3];
+            DATA = load_big_endian(&page->bytes[index & 0xFFF]); //alligned, so the word never crosses into the next page
+        }
     }
 
     else if(memory_location == 0x30000000){ //GETC
 
-        uint8_t input;
+        uint8_t input_byte;
     
-        try{
-            input = std::getchar();
-        }
-        catch(std::ios_base::failure){
-            //// std::cerr << "input fail" << std::endl;
-            std::exit(-21);
-        }
+        if(input != NULL){
 
-        if(std::cin.eof()){
-            DATA = 0xFFFFFFFF;  //return -1
+            input_byte = (input_position < input->size()) ? (*input)[input_position++] : EOF; //the same byte getchar gives at the end
         }
         else{
-            
-            //zero extension
-            DATA = input;
+
+            mips_console& console = mips_console_standard(); //read ahead on its own thread, this only waits if nothing is there yet
+
+            int got = console.get();
+
+            if(got == EOF && console.input_failed()){
+                return MIPS_IO_ERROR;
+            }
+
+            input_byte = got;
         }
+
+        //zero extension. At the end of the input that is 0xFF, the low byte of EOF
+        DATA = input_byte;
     }
 
     else if(memory_location < 0x11000000 && memory_location >= 0x10000000){ //if it is in ADDR_INSTR
 
         DATA = read_INSTR(memory_location);
     }
+    else if(((uint32_t)memory_location >> 12) == 0x30000){ //the rest of the I/O page, a device if there is one
+
+        uint32_t offset;
+        mips_device* device = find_device(memory_location, offset);
+
+        if(device == NULL){
+            return MIPS_MEMORY_TRAP;
+        }
+
+        mips_status status = device->read(*this, offset, DATA);
+
+        if(status != MIPS_OK){
+            return status;
+        }
+    }
     else{ //address out of bounds
 
-        exit(-11);
+        return MIPS_MEMORY_TRAP;
     }
 
-    return DATA;  
+    data = DATA;
+
+    return MIPS_OK;
 }
 
-void mips_memory::write_DATA(uint32_t data, int memory_location){//the index is the offset memory (to get it from original memory location, subtract 0x20000000)
+mips_status mips_memory::write_DATA(uint32_t data, int memory_location){//the index is the offset memory (to get it from original memory location, subtract 0x20000000)
 
     if((memory_location & 0b11) != 0){ //not alligned
-        exit(-11);
+        return MIPS_MEMORY_TRAP;
     }
 
     if(memory_location < 0x24000000 && memory_location >= 0x20000000){ //if it is in ADDR_DATA area
-        int index = memory_location - 0x20000000;
+        uint32_t index = memory_location - 0x20000000;
 
-        ADDR_DATA[index + 3] = 0b11111111 & data;
-        ADDR_DATA[index + 2] = 0b11111111 & (data >> 8);
-        ADDR_DATA[index + 1] = 0b11111111 & (data >> 16);
-        ADDR_DATA[index] = 0b11111111 & (data >> 24);
+        store_big_endian(&data_page_write(index)->bytes[index & 0xFFF], data);
     }
 
     else if(memory_location == 0x30000004){ //PUTC
 
         uint8_t temp = data & 0xFF; //truncating the data to a byte
 
-        try{
-            //// std::cerr << std::hex << temp << std::endl;
-            std::putchar(temp);
+        if(output != NULL){
+
+            output->push_back(temp);
+        }
+        else if(!mips_console_standard().put(temp)){ //written out by the console's own thread
+
+            return MIPS_IO_ERROR;
         }
-        catch(std::ios_base::failure){
-        
-            // std::cerr << "PUTC error" << std::endl;
-            std::exit(-21);
-        } 
     } 
 
+    else if(((uint32_t)memory_location >> 12) == 0x30000){ //the rest of the I/O page, a device if there is one
+
+        uint32_t offset;
+        mips_device* device = find_device(memory_location, offset);
+
+        if(device == NULL){
+            return MIPS_MEMORY_TRAP;
+        }
+
+        return device->write(*this, offset, data);
+    }
+
     else{ //address out of bounds
 
-        exit(-11);
+        return MIPS_MEMORY_TRAP;
     } 
+
+    return MIPS_OK;
+}
+
+mips_status mips_memory::read_BYTE(uint32_t memory_location, uint8_t& data){
+
+    if(memory_location < 0x24000000 && memory_location >= 0x20000000){ //ADDR_DATA, straight from the page
+
+        uint32_t index = memory_location - 0x20000000;
+
+        const mips_data_page* page = data_page(index);
+
+        data = (page == NULL) ? 0 : page->bytes[index & 0xFFF];
+
+        return MIPS_OK;
+    }
+
+    //GETC and ADDR_INSTR: the byte of the word at its place (big endian)
+    uint32_t word;
+    mips_status status = read_DATA(memory_location & ~3u, word);
+
+    if(status != MIPS_OK){
+        return status;
+    }
+
+    data = word >> (8 * (3 - (memory_location & 3)));
+
+    return MIPS_OK;
+}
+
+mips_status mips_memory::read_HALF(uint32_t memory_location, uint16_t& data){
+
+    if(memory_location < 0x24000000 && memory_location >= 0x20000000 && (memory_location & 1) == 0){
+
+        uint32_t index = memory_location - 0x20000000;
+
+        const mips_data_page* page = data_page(index);
+
+        data = (page == NULL) ? 0 : (page->bytes[index & 0xFFF] << 8 | page->bytes[(index & 0xFFF) + 1]);
+
+        return MIPS_OK;
+    }
+
+    //the word is read before the allignment is checked, same as it always was (a GETC read still takes a character)
+    uint32_t word;
+    mips_status status = read_DATA(memory_location & ~3u, word);
+
+    if(status != MIPS_OK){
+        return status;
+    }
+
+    if((memory_location & 1) != 0){ //not alligned
+        return MIPS_MEMORY_TRAP;
+    }
+
+    data = word >> (8 * (2 - (memory_location & 2)));
+
+    return MIPS_OK;
+}
+
+mips_status mips_memory::write_BYTE(uint8_t data, uint32_t memory_location){
+
+    if(memory_location < 0x24000000 && memory_location >= 0x20000000){
+
+        uint32_t index = memory_location - 0x20000000;
+
+        data_page_write(index)->bytes[index & 0xFFF] = data;
+
+        return MIPS_OK;
+    }
+
+    uint32_t word = 0; //PUTC isn't readable, the rest of its word is 0
+
+    if((memory_location & ~3u) != 0x30000004){
+
+        mips_status status = read_DATA(memory_location & ~3u, word);
+
+        if(status != MIPS_OK){
+            return status;
+        }
+    }
+
+    uint32_t shift = 8 * (3 - (memory_location & 3));
+
+    word = (word & ~(0xFFu << shift)) | ((uint32_t)data << shift);
+
+    return write_DATA(word, memory_location & ~3u); //traps unless it is PUTC
+}
+
+mips_status mips_memory::write_HALF(uint16_t data, uint32_t memory_location){
+
+    if(memory_location < 0x24000000 && memory_location >= 0x20000000 && (memory_location & 1) == 0){
+
+        uint32_t index = memory_location - 0x20000000;
+
+        mips_data_page* page = data_page_write(index);
+
+        page->bytes[index & 0xFFF] = data >> 8;
+        page->bytes[(index & 0xFFF) + 1] = data;
+
+        return MIPS_OK;
+    }
+
+    uint32_t word = 0;
+
+    if((memory_location & ~3u) != 0x30000004){
+
+        mips_status status = read_DATA(memory_location & ~3u, word);
+
+        if(status != MIPS_OK){
+            return status;
+        }
+    }
+
+    if((memory_location & 1) != 0){ //not alligned
+        return MIPS_MEMORY_TRAP;
+    }
+
+    uint32_t shift = 8 * (2 - (memory_location & 2));
+
+    word = (word & ~(0xFFFFu << shift)) | ((uint32_t)data << shift);
+
+    return write_DATA(word, memory_location & ~3u);
+}
+
+//guard page mode: one host access, it faults if the address isn't in ADDR_INSTR/ADDR_DATA (ADDR_INSTR is mapped read only, so a store
+//to it faults too). Only the GETC/PUTC page goes the normal way, it is the same in both modes
+
+mips_status mips_memory::guard_read_DATA(int memory_location, uint32_t& data){
+
+    if((memory_location & 0b11) != 0){ //not alligned
+        return MIPS_MEMORY_TRAP;
+    }
+
+    if(((uint32_t)memory_location >> 12) == 0x30000){
+        return read_DATA(memory_location, data);
+    }
+
+    data = load_big_endian(guard + (uint32_t)memory_location);
+
+    return MIPS_OK;
+}
+
+mips_status mips_memory::guard_write_DATA(uint32_t data, int memory_location){
+
+    if((memory_location & 0b11) != 0){ //not alligned
+        return MIPS_MEMORY_TRAP;
+    }
+
+    if(((uint32_t)memory_location >> 12) == 0x30000){
+        return write_DATA(data, memory_location);
+    }
+
+    store_big_endian(guard + (uint32_t)memory_location, data);
+
+    return MIPS_OK;
+}
+
+mips_status mips_memory::guard_read_BYTE(uint32_t memory_location, uint8_t& data){
+
+    if((memory_location >> 12) == 0x30000){
+        return read_BYTE(memory_location, data);
+    }
+
+    data = guard[memory_location];
+
+    return MIPS_OK;
+}
+
+mips_status mips_memory::guard_read_HALF(uint32_t memory_location, uint16_t& data){
+
+    if((memory_location >> 12) == 0x30000){
+        return read_HALF(memory_location, data);
+    }
+
+    if((memory_location & 1) != 0){ //not alligned
+        return MIPS_MEMORY_TRAP;
+    }
+
+    data = guard[memory_location] << 8 | guard[memory_location + 1];
+
+    return MIPS_OK;
+}
+
+mips_status mips_memory::guard_write_BYTE(uint8_t data, uint32_t memory_location){
+
+    if((memory_location >> 12) == 0x30000){
+        return write_BYTE(data, memory_location);
+    }
+
+    guard[memory_location] = data;
+
+    return MIPS_OK;
+}
+
+mips_status mips_memory::guard_write_HALF(uint16_t data, uint32_t memory_location){
+
+    if((memory_location >> 12) == 0x30000){
+        return write_HALF(data, memory_location);
+    }
+
+    if((memory_location & 1) != 0){
+        return MIPS_MEMORY_TRAP;
+    }
+
+    guard[memory_location] = data >> 8;
+    guard[memory_location + 1] = data;
+
+    return MIPS_OK;
+}
+
+void mips_memory::clear(){
+
+    clear_INSTR();
+    clear_DATA();
+}
+
+void mips_memory::clear_INSTR(){
+
+    ADDR_INSTR = NULL;
+
+    INSTR_SIZE = 0;
+    LAST_INSTR_ADDRESS = 0x10000000 - 4;
+
+    DATA_IMAGE = NULL;
+
+    if(guard != NULL){
+        guard_copy_INSTR();
+    }
+}
+
+void mips_memory::clear_DATA(){
+
+    //a page that doesn't exist reads as 0, so freeing them is the same as zeroing them (and only costs as much as the pages that were used)
+    for(int i = 0; i < 0x40; i++){
+        ADDR_DATA[i].reset();
+    }
+
+    restored = NULL;
+    dirty.clear();
+
+#ifdef MIPS_GUARD_PAGES
+    if(guard != NULL){
+        madvise(guard + 0x20000000, 0x4000000, MADV_DONTNEED); //gives the pages back, they read as 0 again
+    }
+#endif
+
+    if(DATA_IMAGE == NULL){
+        return;
+    }
+
+    //then what the binary starts with (only the pages with something in them get allocated)
+    for(size_t i = 0; i < DATA_IMAGE->size(); i++){
+
+        const mips_data_segment& segment = (*DATA_IMAGE)[i];
+
+        for(uint32_t done = 0; done < segment.size; ){
+
+            uint32_t offset = segment.address - 0x20000000 + done;
+            const uint8_t* source = segment.bytes.get() + done;
+
+            //up to the end of the page
+            uint32_t length = std::min(segment.size - done, 0x1000 - (offset & 0xFFF));
+
+            if(guard != NULL){
+                std::memcpy(guard + 0x20000000 + offset, source, length);
+            }
+            else if(length == 0x1000){
+
+                //a whole page: the page is the segment's bytes, borrowed until the first write copies it
+                std::unique_ptr<mips_data_table>& table = ADDR_DATA[offset >> 20];
+
+                if(!table){
+                    table.reset(new mips_data_table());
+                }
+
+                table->pages[(offset >> 12) & 0xFF] = std::shared_ptr<mips_data_page>(segment.bytes, (mips_data_page*)source);
+                table->borrowed[(offset >> 12) & 0xFF] = true;
+            }
+            else{
+                std::memcpy(&data_page_write(offset)->bytes[offset & 0xFFF], source, length);
+            }
+
+            done += length;
+        }
+    }
+}
+
+std::shared_ptr<const mips_data_snapshot> mips_memory::snapshot_DATA(){
+
+    std::shared_ptr<mips_data_snapshot> snapshot = std::make_shared<mips_data_snapshot>();
+
+#ifdef MIPS_GUARD_PAGES
+    if(guard != NULL){
+
+        //the stores went straight to the reservation, so which pages were written is only known to the host: the ones it has memory for
+        std::vector<unsigned char> resident(0x4000);
+
+        mincore(guard + 0x20000000, 0x4000000, &resident[0]);
+
+        for(uint32_t i = 0; i < 0x4000; i++){
+
+            if((resident[i] & 1) == 0){
+                continue;
+            }
+
+            std::unique_ptr<mips_data_table>& table = snapshot->ADDR_DATA[i >> 8];
+
+            if(!table){
+                table.reset(new mips_data_table());
+            }
+
+            table->pages[i & 0xFF] = std::make_shared<mips_data_page>();
+            std::memcpy(table->pages[i & 0xFF]->bytes, guard + 0x20000000 + ((size_t)i << 12), 0x1000);
+        }
+
+        return snapshot;
+    }
+#endif
+
+    //only the page pointers are copied, the memory and the snapshot share every page until it is written
+    for(int i = 0; i < 0x40; i++){
+
+        if(ADDR_DATA[i]){
+            snapshot->ADDR_DATA[i].reset(new mips_data_table(*ADDR_DATA[i]));
+        }
+    }
+
+    restored = snapshot;
+    dirty.clear();
+
+    return snapshot;
+}
+
+void mips_memory::restore_DATA(const std::shared_ptr<const mips_data_snapshot>& snapshot){
+
+#ifdef MIPS_GUARD_PAGES
+    if(guard != NULL){
+
+        madvise(guard + 0x20000000, 0x4000000, MADV_DONTNEED); //the host only has work for the pages that have memory
+
+        for(int i = 0; i < 0x40; i++){
+
+            if(!snapshot->ADDR_DATA[i]){
+                continue;
+            }
+
+            for(int j = 0; j < 0x100; j++){
+
+                if(snapshot->ADDR_DATA[i]->pages[j]){
+                    std::memcpy(guard + 0x20000000 + ((size_t)i << 20) + ((size_t)j << 12), snapshot->ADDR_DATA[i]->pages[j]->bytes, 0x1000);
+                }
+            }
+        }
+
+        return;
+    }
+#endif
+
+    if(snapshot == restored){
+
+        //every other page is still the snapshot's
+        for(size_t i = 0; i < dirty.size(); i++){
+
+            const mips_data_table* table = snapshot->ADDR_DATA[dirty[i] >> 8].get();
+
+            ADDR_DATA[dirty[i] >> 8]->pages[dirty[i] & 0xFF] = (table != NULL) ? table->pages[dirty[i] & 0xFF] : NULL;
+            ADDR_DATA[dirty[i] >> 8]->borrowed[dirty[i] & 0xFF] = (table != NULL) && table->borrowed[dirty[i] & 0xFF];
+        }
+
+        dirty.clear();
+        return;
+    }
+
+    for(int i = 0; i < 0x40; i++){
+
+        if(snapshot->ADDR_DATA[i]){
+            ADDR_DATA[i].reset(new mips_data_table(*snapshot->ADDR_DATA[i]));
+        }
+        else{
+            ADDR_DATA[i].reset();
+        }
+    }
+
+    restored = snapshot;
+    dirty.clear();
+}
+
+void mips_memory::set_io(const std::string* input_in, std::string* output_in){
+
+    input = input_in;
+    input_position = 0;
+    output = output_in;
+}
+
+bool mips_memory::attach_device(uint32_t address, std::unique_ptr<mips_device> device){
+
+    if(address < 0x30000008 || (address & 3) != 0 || (uint64_t)address + device->size() > 0x30001000){
+        return false;
+    }
+
+    for(size_t i = 0; i < devices.size(); i++){
+
+        if(devices[i].address == address){
+            devices[i].device = std::move(device);
+            return true;
+        }
+    }
+
+    mips_device_slot slot;
+    slot.address = address;
+    slot.device = std::move(device);
+
+    devices.push_back(std::move(slot));
+
+    return true;
+}
+
+void mips_memory::detach_device(uint32_t address){
+
+    for(size_t i = 0; i < devices.size(); i++){
+
+        if(devices[i].address == address){
+            devices.erase(devices.begin() + i);
+            return;
+        }
+    }
+}
+
+void mips_memory::reset_devices(){
+
+    for(size_t i = 0; i < devices.size(); i++){
+        devices[i].device->reset();
+    }
+}
+
+mips_device* mips_memory::find_device(uint32_t address, uint32_t& offset){
+
+    //only a few of them, and only I/O gets here
+    for(size_t i = 0; i < devices.size(); i++){
+
+        if(address >= devices[i].address && address - devices[i].address < devices[i].device->size()){
+
+            offset = address - devices[i].address;
+            return devices[i].device.get();
+        }
+    }
+
+    return NULL;
+}
+
+static const uint8_t zero_page[0x1000] = {0}; //what a page that was never written holds
+
+mips_status mips_memory::write_output(uint32_t address, uint32_t length){
+
+    if(length == 0){
+        return MIPS_OK;
+    }
+
+    bool in_data = (address >= 0x20000000 && (uint64_t)address + length <= 0x24000000);
+    bool in_instr = (address >= 0x10000000 && (uint64_t)address + length <= 0x11000000);
+
+    if(!in_data && !in_instr){
+        return MIPS_MEMORY_TRAP;
+    }
+
+    while(length > 0){
+
+        //the longest run of bytes that is in one place on the host
+        const uint8_t* chunk;
+        uint32_t chunk_length;
+
+        if(guard != NULL){
+
+            chunk = guard + address;
+            chunk_length = length;
+        }
+        else if(in_instr){
+
+            uint32_t index = address - 0x10000000;
+
+            if(index < (uint32_t)INSTR_SIZE){
+                chunk = ADDR_INSTR.get() + index;
+                chunk_length = std::min(length, INSTR_SIZE - index);
+            }
+            else{ //past the end of the binary is 0
+                chunk = zero_page;
+                chunk_length = std::min(length, (uint32_t)0x1000);
+            }
+        }
+        else{
+
+            uint32_t index = address - 0x20000000;
+            const mips_data_page* page = data_page(index);
+
+            chunk_length = std::min(length, 0x1000 - (index & 0xFFF));
+            chunk = (page != NULL) ? &page->bytes[index & 0xFFF] : zero_page;
+        }
+
+        if(output != NULL){
+            output->append((const char*)chunk, chunk_length);
+        }
+        else if(!mips_console_standard().put(chunk, chunk_length)){
+            return MIPS_IO_ERROR;
+        }
+
+        address += chunk_length;
+        length -= chunk_length;
+    }
+
+    return MIPS_OK;
+}
+
+mips_status mips_memory::read_input(uint32_t address, uint32_t length, uint32_t& got){
+
+    got = 0;
+
+    if(length == 0){
+        return MIPS_OK;
+    }
+
+    if(address < 0x20000000 || (uint64_t)address + length > 0x24000000){
+        return MIPS_MEMORY_TRAP;
+    }
+
+    while(got < length){
+
+        uint32_t index = address + got - 0x20000000;
+
+        //a page at a time, or all of it in guard page mode
+        uint32_t chunk_length = (guard != NULL) ? length - got : std::min(length - got, 0x1000 - (index & 0xFFF));
+        uint8_t* chunk = (guard != NULL) ? guard + address + got : &data_page_write(index)->bytes[index & 0xFFF];
+
+        uint32_t read;
+
+        if(input != NULL){
+
+            read = std::min((size_t)chunk_length, input->size() - input_position);
+
+            std::memcpy(chunk, input->data() + input_position, read);
+            input_position += read;
+        }
+        else{
+
+            mips_console& console = mips_console_standard();
+
+            read = console.get(chunk, chunk_length);
+
+            if(read < chunk_length && console.input_failed()){
+                return MIPS_IO_ERROR;
+            }
+        }
+
+        got += read;
+
+        if(read < chunk_length){ //the end of the input
+            break;
+        }
+    }
+
+    return MIPS_OK;
+}
+
+mips_status mips_memory::copy_in_DATA(uint32_t address, const uint8_t* source, uint32_t length){
+
+    if(length == 0){
+        return MIPS_OK;
+    }
+
+    if(address < 0x20000000 || (uint64_t)address + length > 0x24000000){
+        return MIPS_MEMORY_TRAP;
+    }
+
+    if(guard != NULL){
+
+        std::memcpy(guard + address, source, length);
+        return MIPS_OK;
+    }
+
+    for(uint32_t done = 0; done < length; ){
+
+        uint32_t index = address + done - 0x20000000;
+        uint32_t chunk_length = std::min(length - done, 0x1000 - (index & 0xFFF));
+
+        std::memcpy(&data_page_write(index)->bytes[index & 0xFFF], source + done, chunk_length);
+
+        done += chunk_length;
+    }
+
+    return MIPS_OK;
 }
 
 uint32_t mips_memory::read_LAST_INSTR_ADDRESS(){
@@ -144,6 +1097,11 @@ uint32_t mips_memory::read_LAST_INSTR_ADDRESS(){
     return LAST_INSTR_ADDRESS;
 }
 
+uint32_t mips_memory::read_INSTR_SIZE(){
+
+    return INSTR_SIZE;
+}
+
 
 
 
@@ -2,6 +2,63 @@
 #ifndef MIPS_MEMORY
 #define MIPS_MEMORY   //making sure it is not included twice
 
+#include <bitset>
+#include <csetjmp>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mips_status.hpp"
+
+class mips_device;
+
+//guard page mode needs a 64 bit host, so the whole 4 GiB MIPS address space fits in one reservation, and SIGSEGV with the fault address
+#if defined(__linux__) && defined(__LP64__)
+#define MIPS_GUARD_PAGES
+#endif
+
+//ADDR_DATA is kept in 4 KiB pages, each allocated by the first write to it. A page that was never written reads as 0,
+//so a run only pays (in time and resident memory) for the pages it uses, not for the whole 64 MB.
+//the bytes are in MIPS (big endian) order, so a byte or halfword is at its own offset and a word is one host access and a byte swap
+struct mips_data_page{
+
+    uint8_t bytes[0x1000];
+};
+
+//the first level of the page table: 256 pages, 1 MiB of ADDR_DATA. Allocated with the first page written in it.
+//a page can be shared with snapshots (and the memories restored from them), it is copied by the first write to it then
+struct mips_data_table{
+
+    std::shared_ptr<mips_data_page> pages[0x100];
+
+    //pages that are a DATA_IMAGE segment's own bytes (which can be read only, like a mapped file): the first write always copies them,
+    //however many others share them
+    std::bitset<0x100> borrowed;
+};
+
+//ADDR_DATA as it was when snapshot_DATA() took it. Never written, so any number of memories can be restored from one
+struct mips_data_snapshot{
+
+    std::unique_ptr<mips_data_table> ADDR_DATA[0x40];
+};
+
+//a device and where its registers start
+struct mips_device_slot{
+
+    uint32_t address;
+    std::unique_ptr<mips_device> device;
+};
+
+//bytes a binary starts with in ADDR_DATA (an initialised data segment, or a data file). Everything else in ADDR_DATA starts as 0.
+//never written: a page that is all in the segment is used where it is (e.g. in a mapped file) until the program writes to it
+struct mips_data_segment{
+
+    uint32_t address;
+    std::shared_ptr<const uint8_t> bytes;
+    uint32_t size;
+};
+
 class mips_memory{
 
     public:
@@ -9,6 +66,17 @@ class mips_memory{
     //constructor
     mips_memory();
 
+    //frees the guard page reservation, if there is one
+    ~mips_memory();
+
+    //guard page mode: the whole 4 GiB address space is reserved with nothing mapped but ADDR_INSTR (read only) and ADDR_DATA (read/write).
+    //a load or store is then a single host access at base + address, without the region checks. An access anywhere else makes the host
+    //fault, and the run stops with MIPS_MEMORY_TRAP (see mips_guard_enter). GETC/PUTC still go through the normal checks.
+    //the loads and stores of each mode are separate functions (the guard_ ones below), see mips_memory_paged/mips_memory_guarded.
+    //returns false if the host can't do it, the memory stays paged then. Switching clears ADDR_DATA (see clear_DATA), the binary stays loaded
+    bool set_guard_pages(bool on);
+    bool guard_pages() const;
+
     ///////////////////////////////
     ///// READING FROM MEMORY /////
     ///////////////////////////////
@@ -16,8 +84,17 @@ class mips_memory{
     //read instruction from ADDR_INSTR. Memory location is from 0x10000000 to 0x11000000-1.
     uint32_t read_INSTR(int memory_location); 
 
-    //read data from ADDR_DATA. Memory location is from 0x20000000 to 0x24000000-1.
-    uint32_t read_DATA(int memory_location); 
+    //the loads and stores below are for the paged memory, in guard page mode use the guard_ ones.
+
+    //read data from ADDR_DATA (or ADDR_INSTR, or GETC) into data. Memory location is from 0x20000000 to 0x24000000-1.
+    //returns MIPS_MEMORY_TRAP for an unaligned or unreadable address and MIPS_IO_ERROR if the input fails, data is not changed then
+    mips_status read_DATA(int memory_location, uint32_t& data);
+
+    //read a byte / halfword (big endian) from anywhere read_DATA can read. In ADDR_DATA this is a single access,
+    //anywhere else it is the matching part of the word read_DATA gives (so a byte read from GETC still reads a character).
+    //read_HALF returns MIPS_MEMORY_TRAP if the address is not a multiple of 2
+    mips_status read_BYTE(uint32_t memory_location, uint8_t& data);
+    mips_status read_HALF(uint32_t memory_location, uint16_t& data);
 
 
     ///////////////////////////////
@@ -25,17 +102,89 @@ class mips_memory{
     ///////////////////////////////
 
     //Load instructions into ADDR_INSTR
-    void copy_ADDR_INSTR(char* source);
+    void copy_ADDR_INSTR(const char* source);
+
+    //use size bytes at image as the binary, without copying them (e.g. a file from mips_map_file). Also forgets the DATA_IMAGE
+    void set_ADDR_INSTR(std::shared_ptr<const uint8_t> image, int size);
+
+    //adds a segment to what clear_DATA() puts in ADDR_DATA instead of zeros everywhere, over any segments added before. ADDR_DATA doesn't change until then
+    void add_DATA_IMAGE(const mips_data_segment& segment);
+
+    //use the binary (and DATA_IMAGE) another memory has loaded instead of a copy of it (it is never written, so any number of memories can share it)
+    void share_ADDR_INSTR(const mips_memory& source);
 
     //sets the size of the bin file (used to keep track where the end of instructions is)
     void set_INSTR_SIZE(int size);
 
-    //write data to memory. Memory location is from 0x20000000 to 0x24000000-1.
-    void write_DATA(uint32_t data, int memory_location);
+    //write data to memory (or PUTC). Memory location is from 0x20000000 to 0x24000000-1.
+    //returns MIPS_MEMORY_TRAP for an unaligned or unwritable address and MIPS_IO_ERROR if the output fails
+    mips_status write_DATA(uint32_t data, int memory_location);
+
+    //write a byte / halfword. In ADDR_DATA this is a single access, PUTC gets the word with the byte/halfword at its place and 0 in the rest,
+    //anywhere else the word is read first like a read-modify-write would (a GETC read, then a trap). write_HALF traps if not a multiple of 2
+    mips_status write_BYTE(uint8_t data, uint32_t memory_location);
+    mips_status write_HALF(uint16_t data, uint32_t memory_location);
+
+    //the same loads and stores in guard page mode (only then): the same results, from a single host access
+    mips_status guard_read_DATA(int memory_location, uint32_t& data);
+    mips_status guard_read_BYTE(uint32_t memory_location, uint8_t& data);
+    mips_status guard_read_HALF(uint32_t memory_location, uint16_t& data);
+    mips_status guard_write_DATA(uint32_t data, int memory_location);
+    mips_status guard_write_BYTE(uint8_t data, uint32_t memory_location);
+    mips_status guard_write_HALF(uint16_t data, uint32_t memory_location);
+
+    //zeroes ADDR_DATA and forgets the loaded binary
+    void clear();
+
+    //forgets the loaded binary and its DATA_IMAGE (ADDR_INSTR reads as 0 again), ADDR_DATA stays as it is
+    void clear_INSTR();
+
+    //zeroes ADDR_DATA only (by freeing its pages) and puts the DATA_IMAGE back in, the binary stays loaded
+    void clear_DATA();
+
+    //ADDR_DATA as it is now. The pages are shared with the snapshot instead of copied, and copied by the next write to them
+    //(in guard page mode the pages in use are copied)
+    std::shared_ptr<const mips_data_snapshot> snapshot_DATA();
+
+    //ADDR_DATA back to how it was in snapshot. Restoring the snapshot that was last taken or restored only puts back the pages written since,
+    //anything else (or after a clear_DATA) replaces all of ADDR_DATA. In guard page mode the pages in use are dropped and the snapshot copied in
+    void restore_DATA(const std::shared_ptr<const mips_data_snapshot>& snapshot);
 
     //return the LAST_INSTR_INDEX (if the PC equals that then the program reached the end)
     uint32_t read_LAST_INSTR_ADDRESS();
 
+    //return the size of the loaded binary in bytes
+    uint32_t read_INSTR_SIZE();
+
+    //where GETC reads from and PUTC writes to: stdin/stdout, or the given strings if they are not NULL (the batch runner gives every run its own)
+    void set_io(const std::string* input_in, std::string* output_in);
+
+
+    ///////////////////////////////
+    ////////// DEVICES ////////////
+    ///////////////////////////////
+
+    //puts device's registers at address, in the I/O page after GETC/PUTC (0x30000008 to 0x30000FFF), instead of any device already there.
+    //loads and stores to the rest of the page still trap. False if it doesn't fit there or isn't word aligned.
+    //every memory starts with a mips_dma_device at 0x30000010
+    bool attach_device(uint32_t address, std::unique_ptr<mips_device> device);
+
+    //takes the device at address out again (nothing if there is none there), its registers trap from then on
+    void detach_device(uint32_t address);
+
+    //every device's registers back to how they start
+    void reset_devices();
+
+    //for devices, whole buffers at once:
+    //writes length bytes at address (in ADDR_DATA or ADDR_INSTR) to where PUTC writes
+    mips_status write_output(uint32_t address, uint32_t length);
+
+    //reads up to length bytes from where GETC reads to address in ADDR_DATA, got is how many (less only at the end of the input)
+    mips_status read_input(uint32_t address, uint32_t length, uint32_t& got);
+
+    //copies length bytes from the host to address in ADDR_DATA
+    mips_status copy_in_DATA(uint32_t address, const uint8_t* source, uint32_t length);
+
 
     //maybe some kind of flags for testing?
 
@@ -43,12 +192,69 @@ class mips_memory{
 
     private:
 
-    std::vector<uint8_t> ADDR_INSTR;
+    std::shared_ptr<const uint8_t> ADDR_INSTR; //INSTR_SIZE bytes, a copy or the mapped file (the deleter knows which). The rest of ADDR_INSTR reads as 0. Shared by memories running the same binary
     int INSTR_SIZE; // added here so we don't have to manually count it too many times. Counted in bytes.
     int LAST_INSTR_ADDRESS; //shows the last instruction, used to compare with PC to check if the program finished.
 
-    std::vector<uint8_t> ADDR_DATA;
+    std::shared_ptr<const std::vector<mips_data_segment> > DATA_IMAGE; //initialised data that comes with the binary, NULL if none
+
+    std::unique_ptr<mips_data_table> ADDR_DATA[0x40]; //64 tables of 256 pages, index with offset >> 20, then (offset >> 12) & 0xFF
+
+    //the page holding offset (from 0x20000000), NULL if it was never written
+    const mips_data_page* data_page(uint32_t offset) const;
+
+    //the page holding offset, allocated (zeroed) if it doesn't exist yet, or copied if it is shared with a snapshot
+    mips_data_page* data_page_write(uint32_t offset);
+
+    std::shared_ptr<const mips_data_snapshot> restored; //what ADDR_DATA was last snapshot or restored to, NULL after a clear_DATA
+    std::vector<uint32_t> dirty; //the pages (offset >> 12) allocated or copied since then, what restoring restored again has to put back
+
+    uint8_t* guard; //base of the 4 GiB reservation in guard page mode (MIPS address 0), NULL when paged
+
+    //puts the loaded binary into the reservation's ADDR_INSTR (the rest of it reads as 0)
+    void guard_copy_INSTR();
+
+    friend void mips_guard_enter(const mips_memory& memory, sigjmp_buf* fault);
+
+    std::vector<mips_device_slot> devices;
+
+    //the device with a register at address (and which one), NULL if there is none
+    mips_device* find_device(uint32_t address, uint32_t& offset);
+
+    const std::string* input; //NULL for stdin
+    size_t input_position;
+    std::string* output; //NULL for stdout
 
 };
 
+//how the load and store handlers reach memory, one for each mode. The engines are compiled for both and pick one when a run starts
+//(by mips_memory::guard_pages), so neither mode checks which one it is on every access
+struct mips_memory_paged{
+
+    static mips_status read_DATA(mips_memory& memory, uint32_t address, uint32_t& data){ return memory.read_DATA(address, data); }
+    static mips_status read_BYTE(mips_memory& memory, uint32_t address, uint8_t& data){ return memory.read_BYTE(address, data); }
+    static mips_status read_HALF(mips_memory& memory, uint32_t address, uint16_t& data){ return memory.read_HALF(address, data); }
+    static mips_status write_DATA(mips_memory& memory, uint32_t data, uint32_t address){ return memory.write_DATA(data, address); }
+    static mips_status write_BYTE(mips_memory& memory, uint8_t data, uint32_t address){ return memory.write_BYTE(data, address); }
+    static mips_status write_HALF(mips_memory& memory, uint16_t data, uint32_t address){ return memory.write_HALF(data, address); }
+};
+
+struct mips_memory_guarded{
+
+    static mips_status read_DATA(mips_memory& memory, uint32_t address, uint32_t& data){ return memory.guard_read_DATA(address, data); }
+    static mips_status read_BYTE(mips_memory& memory, uint32_t address, uint8_t& data){ return memory.guard_read_BYTE(address, data); }
+    static mips_status read_HALF(mips_memory& memory, uint32_t address, uint16_t& data){ return memory.guard_read_HALF(address, data); }
+    static mips_status write_DATA(mips_memory& memory, uint32_t data, uint32_t address){ return memory.guard_write_DATA(data, address); }
+    static mips_status write_BYTE(mips_memory& memory, uint8_t data, uint32_t address){ return memory.guard_write_BYTE(data, address); }
+    static mips_status write_HALF(mips_memory& memory, uint16_t data, uint32_t address){ return memory.guard_write_HALF(data, address); }
+};
+
+//maps the file at location read only (reads it on hosts without mmap), data is NULL for an empty file. False if it can't be opened or mapped
+bool mips_map_file(const std::string& location, std::shared_ptr<const uint8_t>& data, size_t& size);
+
+//a guarded memory can only be accessed between these two, mips_simulator::run does it around every run. A fault in its reservation
+//jumps to fault, which has to be from sigsetjmp(fault, 1) in a function that is still running. One guarded memory per thread at a time
+void mips_guard_enter(const mips_memory& memory, sigjmp_buf* fault);
+void mips_guard_leave();
+
 #endif
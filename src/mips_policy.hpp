@@ -0,0 +1,184 @@
+#include <cstdint>
+#include <ostream>
+
+#include "mips_breakdown.hpp"
+#include "mips_profile.hpp"
+#include "mips_timing.hpp"
+#include "mips_cache.hpp"
+
+#ifndef MIPS_POLICY
+#define MIPS_POLICY
+
+//policies for the step loops (program_run_table/program_run_threaded). A policy says at compile time what the loop does besides
+//running instructions, so anything switched off is not in the compiled loop at all instead of being tested every step.
+//a policy has:
+//  count_steps  steps is a budget, the loop stops with MIPS_STEP_LIMIT when it runs out. When false steps is left alone and the loop only stops with the program
+//  instrument   before() is called for every instruction that is about to run (delay slots too)
+//  before(instr, pc, registers)
+//
+//policies put together with mips_policy_pair run every hook they have in the same loop.
+//a new policy has to be added to the explicit instantiations at the end of mips_breakdown.cpp
+
+//what run() uses normally: a step budget and nothing else
+struct mips_policy_release{
+
+    static const bool count_steps = true;
+    static const bool instrument = false;
+
+    void before(const mips_decoded&, uint32_t, const mips_registers&){}
+};
+
+//for runs without a budget (max_steps of UINT64_MAX), so the loop doesn't even count
+struct mips_policy_unlimited : mips_policy_release{
+
+    static const bool count_steps = false;
+};
+
+//prints every instruction before it runs: its address, name and fields
+struct mips_policy_trace : mips_policy_release{
+
+    static const bool instrument = true;
+
+    std::ostream* out;
+
+    mips_policy_trace(std::ostream& out_in) : out(&out_in) {}
+
+    void before(const mips_decoded& instr, uint32_t pc, const mips_registers& registers);
+};
+
+//counts the instruction mix into a mips_mix: every instruction by handler, which way the conditional branches go, the width and alignment
+//of loads and stores and which of them go to the I/O page. All from the instruction and the registers before it runs, the handlers don't know
+struct mips_policy_mix : mips_policy_release{
+
+    static const bool instrument = true;
+
+    mips_mix* mix;
+
+    mips_policy_mix(mips_mix& mix_in) : mix(&mix_in) {}
+
+    void before(const mips_decoded& instr, uint32_t, const mips_registers& registers){
+
+        mix->instructions[instr.handler]++;
+
+        uint32_t address = registers.read_reg(instr.rs) + instr.immediate;
+
+        switch(instr.handler){
+
+            case OP_BEQ: case OP_BNE: case OP_BGEZ: case OP_BGEZAL: case OP_BGTZ: case OP_BLEZ: case OP_BLTZ: case OP_BLTZAL:
+                mix->taken[instr.handler] += mips_branch_taken(instr, registers);
+                return;
+
+            case OP_LB: case OP_LBU: mix->access(mix->loads, address, 1); return;
+            case OP_LH: case OP_LHU: mix->access(mix->loads, address, 2); return;
+            case OP_LW: case OP_LWL: case OP_LWR: mix->access(mix->loads, address, 4); return;
+            case OP_SB: mix->access(mix->stores, address, 1); return;
+            case OP_SH: mix->access(mix->stores, address, 2); return;
+            case OP_SW: mix->access(mix->stores, address, 4); return;
+
+            default: return;
+        }
+    }
+};
+
+//counts an exact call graph into a mips_callgraph, see there
+struct mips_policy_calls : mips_policy_release{
+
+    static const bool instrument = true;
+
+    mips_callgraph* calls;
+
+    mips_policy_calls(mips_callgraph& calls_in) : calls(&calls_in) {}
+
+    void before(const mips_decoded& instr, uint32_t pc, const mips_registers& registers){
+
+        calls->before(instr, pc, registers);
+    }
+};
+
+//runs a mips_timing model alongside the program
+struct mips_policy_timing : mips_policy_release{
+
+    static const bool instrument = true;
+
+    mips_timing* timing;
+
+    mips_policy_timing(mips_timing& timing_in) : timing(&timing_in) {}
+
+    void before(const mips_decoded& instr, uint32_t pc, const mips_registers& registers){
+
+        timing->before(instr, pc, registers);
+    }
+};
+
+//runs an L1 instruction and data cache alongside the program
+struct mips_policy_cache : mips_policy_release{
+
+    static const bool instrument = true;
+
+    mips_caches* caches;
+
+    mips_policy_cache(mips_caches& caches_in) : caches(&caches_in) {}
+
+    void before(const mips_decoded& instr, uint32_t pc, const mips_registers& registers){
+
+        caches->before(instr, pc, registers);
+    }
+};
+
+//two policies in one loop: a's before() and then b's for every instruction. It counts steps if either of them does
+template<class A, class B>
+struct mips_policy_pair{
+
+    static const bool count_steps = A::count_steps || B::count_steps;
+    static const bool instrument = A::instrument || B::instrument;
+
+    A a;
+    B b;
+
+    mips_policy_pair(const A& a_in, const B& b_in) : a(a_in), b(b_in) {}
+
+    void before(const mips_decoded& instr, uint32_t pc, const mips_registers& registers){
+
+        if(A::instrument){
+            a.before(instr, pc, registers);
+        }
+
+        if(B::instrument){
+            b.before(instr, pc, registers);
+        }
+    }
+};
+
+//mips_policy_pair<A, B>(a, b) without writing the types out, like std::make_pair
+template<class A, class B>
+mips_policy_pair<A, B> mips_policy_join(const A& a, const B& b){
+
+    return mips_policy_pair<A, B>(a, b);
+}
+
+//a policy that is only on if there is one (policy NULL is off), for putting together whichever are on at run time with one compiled loop
+template<class P>
+struct mips_policy_optional{
+
+    static const bool count_steps = P::count_steps;
+    static const bool instrument = P::instrument;
+
+    P* policy;
+
+    mips_policy_optional(P* policy_in) : policy(policy_in) {}
+
+    void before(const mips_decoded& instr, uint32_t pc, const mips_registers& registers){
+
+        if(policy != NULL){
+            policy->before(instr, pc, registers);
+        }
+    }
+};
+
+//every instrumenting policy, each of them on or off: what mips_simulator runs when more than one is set (with just one it runs that one's own loop)
+typedef mips_policy_pair<mips_policy_optional<mips_policy_trace>,
+        mips_policy_pair<mips_policy_optional<mips_policy_mix>,
+        mips_policy_pair<mips_policy_optional<mips_policy_calls>,
+        mips_policy_pair<mips_policy_optional<mips_policy_timing>, mips_policy_optional<mips_policy_cache> > > > > mips_policy_every;
+
+#endif
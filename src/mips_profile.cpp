@@ -0,0 +1,497 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mips_profile.hpp"
+
+#if defined(__unix__)
+#include <csignal>
+#include <sys/time.h>
+#endif
+
+void mips_mix::clear(){
+
+    std::memset(instructions, 0, sizeof(instructions));
+    std::memset(taken, 0, sizeof(taken));
+    std::memset(loads, 0, sizeof(loads));
+    std::memset(stores, 0, sizeof(stores));
+
+    getc = 0;
+    putc = 0;
+    device = 0;
+}
+
+static bool mix_conditional(int handler){
+
+    return handler == OP_BEQ || handler == OP_BNE || handler == OP_BGEZ || handler == OP_BGEZAL || handler == OP_BGTZ
+        || handler == OP_BLEZ || handler == OP_BLTZ || handler == OP_BLTZAL;
+}
+
+void mips_mix_report(const mips_mix& mix, std::ostream& out){
+
+    out << "kind,name,count\n";
+
+    uint64_t total = 0;
+
+    for(int handler = 0; handler < MIPS_HANDLER_COUNT; handler++){
+        total += mix.instructions[handler];
+    }
+
+    out << "total,instructions," << total << "\n";
+
+    for(int handler = 0; handler < MIPS_HANDLER_COUNT; handler++){
+        out << "instruction," << instruction_name(handler) << "," << mix.instructions[handler] << "\n";
+    }
+
+    for(int handler = 0; handler < MIPS_HANDLER_COUNT; handler++){
+
+        if(mix_conditional(handler)){
+            out << "taken," << instruction_name(handler) << "," << mix.taken[handler] << "\n";
+            out << "not_taken," << instruction_name(handler) << "," << mix.instructions[handler] - mix.taken[handler] << "\n";
+        }
+    }
+
+    static const uint32_t widths[] = {1, 2, 4};
+
+    for(int i = 0; i < 3; i++){
+
+        uint32_t width = widths[i];
+
+        out << "load," << width << "," << mix.loads[width][0] << "\n";
+        out << "load_unaligned," << width << "," << mix.loads[width][1] << "\n";
+        out << "store," << width << "," << mix.stores[width][0] << "\n";
+        out << "store_unaligned," << width << "," << mix.stores[width][1] << "\n";
+    }
+
+    out << "mmio,getc," << mix.getc << "\n";
+    out << "mmio,putc," << mix.putc << "\n";
+    out << "mmio,device," << mix.device << "\n";
+}
+
+bool mips_read_symbol_map(const std::string& location, std::vector<mips_symbol>& symbols){
+
+    std::ifstream map(location);
+
+    if(!map.is_open()){
+        return false;
+    }
+
+    std::string line;
+
+    while(std::getline(map, line)){
+
+        std::istringstream fields(line);
+        std::string address, name, type;
+
+        if(!(fields >> address)){ //empty line
+            continue;
+        }
+
+        if(!(fields >> name)){
+            return false;
+        }
+
+        if(fields >> type){ //nm's "address type name"
+            std::swap(name, type);
+        }
+
+        char* end;
+        unsigned long value = std::strtoul(address.c_str(), &end, 16);
+
+        if(*end != '\0'){
+            return false;
+        }
+
+        mips_symbol symbol;
+        symbol.name = name;
+        symbol.address = value;
+        symbol.size = 0;
+        symbol.function = true;
+
+        symbols.push_back(symbol);
+    }
+
+    return true;
+}
+
+std::string mips_symbol_name(const std::vector<mips_symbol>& symbols, uint32_t address){
+
+    const mips_symbol* best = NULL;
+
+    for(size_t i = 0; i < symbols.size(); i++){
+
+        const mips_symbol& symbol = symbols[i];
+
+        if(symbol.function && symbol.address <= address && (best == NULL || symbol.address > best->address)){
+            best = &symbol;
+        }
+    }
+
+    char text[16];
+
+    if(best == NULL || (best->size > 0 && address - best->address >= best->size)){
+        std::snprintf(text, sizeof(text), "0x%08x", address);
+        return text;
+    }
+
+    if(address == best->address){
+        return best->name;
+    }
+
+    std::snprintf(text, sizeof(text), "+0x%x", address - best->address);
+
+    return best->name + text;
+}
+
+
+///////////////////////////////
+/////////// SAMPLER ///////////
+///////////////////////////////
+
+static mips_sampler* volatile sampling = NULL; //the one running, for the signal handler
+
+mips_sampler::mips_sampler(size_t capacity_in) : samples(new mips_sample[capacity_in]), capacity(capacity_in), count(0), lost(0), registers(NULL){
+}
+
+mips_sampler::~mips_sampler(){
+
+    stop();
+}
+
+void mips_sampler::sample(int){
+
+    mips_sampler* sampler = sampling;
+
+    if(sampler == NULL){
+        return;
+    }
+
+    if(sampler->count == sampler->capacity){
+        sampler->lost = sampler->lost + 1;
+        return;
+    }
+
+    mips_sample& next = sampler->samples[sampler->count];
+    next.pc = sampler->registers->read_pc();
+    next.ra = sampler->registers->read_reg(31);
+
+    sampler->count = sampler->count + 1;
+}
+
+#if defined(__unix__)
+
+static struct sigaction sampling_previous; //the SIGPROF handler from before the one running, put back when it stops
+
+bool mips_sampler::start(const mips_registers& registers_in, uint32_t interval_us){
+
+    if(sampling != NULL || interval_us == 0){
+        return false;
+    }
+
+    registers = &registers_in;
+    sampling = this;
+
+    struct sigaction action;
+    action.sa_handler = sample;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    struct itimerval timer;
+    timer.it_value.tv_sec = interval_us / 1000000;
+    timer.it_value.tv_usec = interval_us % 1000000;
+    timer.it_interval = timer.it_value;
+
+    if(sigaction(SIGPROF, &action, &sampling_previous) != 0){
+        sampling = NULL;
+        return false;
+    }
+
+    if(setitimer(ITIMER_PROF, &timer, NULL) != 0){
+        sigaction(SIGPROF, &sampling_previous, NULL);
+        sampling = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+void mips_sampler::stop(){
+
+    if(sampling != this){
+        return;
+    }
+
+    struct itimerval timer;
+    std::memset(&timer, 0, sizeof(timer));
+    setitimer(ITIMER_PROF, &timer, NULL);
+
+    //ignoring it first drops a signal already on its way, which the handler put back might not expect
+    struct sigaction ignore;
+    ignore.sa_handler = SIG_IGN;
+    ignore.sa_flags = 0;
+    sigemptyset(&ignore.sa_mask);
+
+    sigaction(SIGPROF, &ignore, NULL);
+    sigaction(SIGPROF, &sampling_previous, NULL);
+
+    sampling = NULL;
+}
+
+#else
+
+bool mips_sampler::start(const mips_registers&, uint32_t){
+
+    return false;
+}
+
+void mips_sampler::stop(){
+}
+
+#endif
+
+void mips_sampler::report_hot(std::ostream& out, const std::vector<mips_symbol>& symbols) const{
+
+    std::map<uint32_t, uint64_t> hits;
+
+    for(size_t i = 0; i < count; i++){
+        hits[samples[i].pc]++;
+    }
+
+    std::vector<std::pair<uint64_t, uint32_t> > hottest; //count, address
+
+    for(std::map<uint32_t, uint64_t>::const_iterator i = hits.begin(); i != hits.end(); ++i){
+        hottest.push_back(std::make_pair(i->second, i->first));
+    }
+
+    //by count, then by address
+    std::sort(hottest.begin(), hottest.end(), [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b){
+        return (a.first != b.first) ? a.first > b.first : a.second < b.second;
+    });
+
+    out << "address,function,count\n";
+
+    char address[16];
+
+    for(size_t i = 0; i < hottest.size(); i++){
+
+        std::snprintf(address, sizeof(address), "0x%08x", hottest[i].second);
+        out << address << "," << mips_symbol_name(symbols, hottest[i].second) << "," << hottest[i].first << "\n";
+    }
+
+    if(lost > 0){
+        out << "dropped,," << lost << "\n";
+    }
+}
+
+//a frame of a collapsed stack: the function address is in, without the offset. Looked up once per address
+static const std::string& sampler_frame(std::map<uint32_t, std::string>& names, const std::vector<mips_symbol>& symbols, uint32_t address){
+
+    std::map<uint32_t, std::string>::iterator found = names.find(address);
+
+    if(found == names.end()){
+
+        std::string name = mips_symbol_name(symbols, address);
+        found = names.insert(std::make_pair(address, name.substr(0, name.find('+')))).first;
+    }
+
+    return found->second;
+}
+
+void mips_sampler::report_collapsed(std::ostream& out, const std::vector<mips_symbol>& symbols) const{
+
+    //without symbols every address is a frame of its own
+    std::map<std::string, uint64_t> stacks;
+    std::map<uint32_t, std::string> names;
+
+    for(size_t i = 0; i < count; i++){
+
+        const mips_sample& sample = samples[i];
+
+        std::string stack = sampler_frame(names, symbols, sample.pc);
+
+        //$31 is only a caller if it points back into the binary, after a call (and its delay slot)
+        if(sample.ra >= 0x10000008 && sample.ra < 0x11000000){
+            stack = sampler_frame(names, symbols, sample.ra - 8) + ";" + stack;
+        }
+
+        stacks[stack]++;
+    }
+
+    for(std::map<std::string, uint64_t>::const_iterator i = stacks.begin(); i != stacks.end(); ++i){
+        out << i->first << " " << i->second << "\n";
+    }
+}
+
+
+///////////////////////////////
+////////// CALL GRAPH /////////
+///////////////////////////////
+
+mips_callgraph::mips_callgraph(uint32_t entry, size_t max_depth_in) : stack(new frame[max_depth_in]), max_depth(max_depth_in), overflow(0), pending(NONE), pending_target(0), pending_return(0){
+
+    //the entry is node 0, at the bottom of the stack. Its return address is the exit
+    node_function.push_back(entry);
+    node_parent.push_back(0);
+    node_self.push_back(0);
+    node_calls.push_back(1);
+
+    stack[0].node = 0;
+    stack[0].return_address = 0;
+    depth = 1;
+
+    self = &node_self[0];
+}
+
+uint32_t mips_callgraph::node_for(uint32_t parent, uint32_t target){
+
+    uint64_t key = ((uint64_t)parent << 32) | target;
+
+    std::unordered_map<uint64_t, uint32_t>::iterator found = children.find(key);
+
+    if(found != children.end()){
+        return found->second;
+    }
+
+    uint32_t node = node_function.size();
+
+    node_function.push_back(target);
+    node_parent.push_back(parent);
+    node_self.push_back(0);
+    node_calls.push_back(0);
+
+    children[key] = node;
+
+    return node;
+}
+
+void mips_callgraph::finish_pending(){
+
+    if(pending == CALL){
+
+        if(depth == max_depth){
+            overflow++;
+        }
+        else{
+
+            uint32_t node = node_for(stack[depth - 1].node, pending_target);
+
+            node_calls[node]++;
+
+            stack[depth].node = node;
+            stack[depth].return_address = pending_return;
+            depth++;
+        }
+    }
+    else if(overflow > 0){ //a return from one of the calls too deep to have a frame
+        overflow--;
+    }
+    else{
+
+        //down to the frame it returns from, if there is one. The entry's frame is never popped
+        for(size_t i = depth - 1; i > 0; i--){
+
+            if(stack[i].return_address == pending_target){
+                depth = i;
+                break;
+            }
+        }
+    }
+
+    pending = NONE;
+    self = &node_self[stack[depth - 1].node]; //node_for can move the counts
+}
+
+void mips_callgraph::report_functions(std::ostream& out, const std::vector<mips_symbol>& symbols) const{
+
+    size_t nodes = node_function.size();
+
+    //everything a node ran, its own and its children's. Children come after their parents, so backwards is bottom up
+    std::vector<uint64_t> total(node_self);
+
+    for(size_t node = nodes - 1; node > 0; node--){
+        total[node_parent[node]] += total[node];
+    }
+
+    struct function_counts{
+
+        uint64_t calls;
+        uint64_t self;
+        uint64_t inclusive;
+    };
+
+    std::map<uint32_t, function_counts> functions;
+
+    for(size_t node = 0; node < nodes; node++){
+
+        function_counts& counts = functions[node_function[node]];
+
+        counts.calls += node_calls[node];
+        counts.self += node_self[node];
+
+        //a recursive call is already in the inclusive count of the outermost one
+        bool nested = false;
+
+        for(size_t above = node; above > 0 && !nested; ){
+            above = node_parent[above];
+            nested = (node_function[above] == node_function[node]);
+        }
+
+        if(!nested){
+            counts.inclusive += total[node];
+        }
+    }
+
+    std::vector<std::pair<uint64_t, uint32_t> > order; //inclusive, address
+
+    for(std::map<uint32_t, function_counts>::const_iterator i = functions.begin(); i != functions.end(); ++i){
+        order.push_back(std::make_pair(i->second.inclusive, i->first));
+    }
+
+    std::sort(order.begin(), order.end(), [](const std::pair<uint64_t, uint32_t>& a, const std::pair<uint64_t, uint32_t>& b){
+        return (a.first != b.first) ? a.first > b.first : a.second < b.second;
+    });
+
+    out << "function,address,calls,self,inclusive\n";
+
+    char address[16];
+
+    for(size_t i = 0; i < order.size(); i++){
+
+        const function_counts& counts = functions[order[i].second];
+
+        std::snprintf(address, sizeof(address), "0x%08x", order[i].second);
+        out << mips_symbol_name(symbols, order[i].second) << "," << address << "," << counts.calls << "," << counts.self << "," << counts.inclusive << "\n";
+    }
+}
+
+void mips_callgraph::report_collapsed(std::ostream& out, const std::vector<mips_symbol>& symbols) const{
+
+    size_t nodes = node_function.size();
+
+    //a node's path is its parent's and its own name. Parents come first, so they are always there already
+    std::vector<std::string> paths(nodes);
+    std::map<std::string, uint64_t> stacks;
+
+    for(size_t node = 0; node < nodes; node++){
+
+        std::string name = mips_symbol_name(symbols, node_function[node]);
+        paths[node] = (node == 0) ? name : paths[node_parent[node]] + ";" + name;
+
+        if(node_self[node] > 0){
+            stacks[paths[node]] += node_self[node];
+        }
+    }
+
+    for(std::map<std::string, uint64_t>::const_iterator i = stacks.begin(); i != stacks.end(); ++i){
+        out << i->first << " " << i->second << "\n";
+    }
+}
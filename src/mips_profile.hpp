@@ -0,0 +1,211 @@
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "mips_breakdown.hpp"
+#include "mips_elf.hpp"
+#include "mips_registers.hpp"
+
+#ifndef MIPS_PROFILE
+#define MIPS_PROFILE
+
+//one more than the last mips_handler, for arrays indexed by it
+static const int MIPS_HANDLER_COUNT = OP_JAL + 1;
+
+//the dynamic instruction mix of a run, counted by mips_policy_mix (see mips_simulator::set_profile_mix). Everything is counted as it is
+//about to run, so an instruction that traps is in it too
+struct mips_mix{
+
+    uint64_t instructions[MIPS_HANDLER_COUNT]; //by handler, delay slots too
+    uint64_t taken[MIPS_HANDLER_COUNT];        //the conditional branches that were taken, the rest of them weren't
+
+    //indexed by the width in bytes (1, 2 or 4), then 0 aligned, 1 not. LWL/LWR are words
+    uint64_t loads[5][2];
+    uint64_t stores[5][2];
+
+    uint64_t getc; //loads from GETC
+    uint64_t putc; //stores to PUTC
+    uint64_t device; //loads and stores to the rest of the I/O page
+
+    mips_mix(){ clear(); }
+
+    void clear();
+
+    //one load or store of width bytes at address
+    void access(uint64_t (&kind)[5][2], uint32_t address, uint32_t width){
+
+        kind[width][(address & (width - 1)) != 0]++;
+
+        if((address >> 12) == 0x30000){ //the I/O page
+
+            if(address < 0x30000004){
+                getc++;
+            }
+            else if(address < 0x30000008){
+                putc++;
+            }
+            else{
+                device++;
+            }
+        }
+    }
+};
+
+//writes mix as CSV, "kind,name,count" lines: instruction (every mnemonic), taken/not_taken (every conditional branch),
+//load/store/load_unaligned/store_unaligned (by width in bytes), mmio (getc, putc, device)
+void mips_mix_report(const mips_mix& mix, std::ostream& out);
+
+//reads a symbol map: "address name" or "address type name" lines (what nm prints), the address in hex. Every symbol is taken as a function
+//without a size. False if the file can't be read or a line is neither
+bool mips_read_symbol_map(const std::string& location, std::vector<mips_symbol>& symbols);
+
+//the name of the function address is in ("name+0x10"), its address in hex if there are no symbols or it is in none of them.
+//a symbol without a size (from hand written assembly) takes everything up to the next one
+std::string mips_symbol_name(const std::vector<mips_symbol>& symbols, uint32_t address);
+
+//what mips_sampler records: where the program was, and $31 for who called the function it was in (if it hasn't called anything since)
+struct mips_sample{
+
+    uint32_t pc;
+    uint32_t ra;
+};
+
+//samples a running program every interval of CPU time from a SIGPROF handler, so the engines do nothing extra and any of them can run.
+//the handler only reads the PC and $31 from the registers and writes them to a buffer allocated up front. Once that is full the rest are
+//only counted. The PC is as the engine last stored it: exact for the block, threaded and table engines, for the JIT it is where it last
+//left translated code or ran an instruction through the handlers (a load, store, multiply/divide or HI/LO). SIGPROF is for the whole process, so one sampler runs at a time
+class mips_sampler{
+
+    public:
+
+    mips_sampler(size_t capacity_in = 1 << 22); //~70 minutes of CPU at one sample a millisecond, 32 MB (only the part used is touched)
+
+    ~mips_sampler();
+
+    //starts sampling registers every interval_us microseconds of CPU time. False if the host can't, or another sampler is running
+    bool start(const mips_registers& registers_in, uint32_t interval_us);
+
+    //stops sampling, and puts back the SIGPROF handler there was before start
+    void stop();
+
+    size_t size() const{ return count; }
+    uint64_t dropped() const{ return lost; }
+
+    //"address,function,count" for every address sampled, the hottest first
+    void report_hot(std::ostream& out, const std::vector<mips_symbol>& symbols) const;
+
+    //collapsed stacks ("caller;function count" lines) for flamegraph.pl and the like
+    void report_collapsed(std::ostream& out, const std::vector<mips_symbol>& symbols) const;
+
+    private:
+
+    mips_sampler(const mips_sampler&) = delete;
+    mips_sampler& operator=(const mips_sampler&) = delete;
+
+    static void sample(int);
+
+    std::unique_ptr<mips_sample[]> samples;
+    size_t capacity;
+
+    volatile size_t count;
+    volatile uint64_t lost;
+
+    const mips_registers* registers;
+};
+
+//an exact call graph, counted by mips_policy_calls: a shadow call stack that JAL/JALR (and the taken BGEZAL/BLTZAL) push a frame on and
+//JR $31 pops, and every instruction counted to the frame on top. The frames are nodes of a calling context tree (one node for every
+//path of calls seen), so a node only has to add 1 to its own count per instruction, the rest is worked out for the report.
+//the stack is a flat array allocated up front. A return to somewhere that isn't the top frame's return address pops down to the frame
+//it does return to (longjmp and the like), and is ignored if there is none, so a mismatch never breaks it. Past max_depth frames
+//the deeper calls are only counted, and the instructions go to the deepest frame there is
+class mips_callgraph{
+
+    public:
+
+    //entry is where the program starts, the function at the bottom of the stack
+    mips_callgraph(uint32_t entry, size_t max_depth = 4096);
+
+    //one instruction about to run
+    void before(const mips_decoded& instr, uint32_t pc, const mips_registers& registers){
+
+        (*self)++;
+
+        //a call/return changes the frame after its delay slot, which is still the caller's
+        if(pending != NONE){
+            finish_pending();
+        }
+
+        switch(instr.handler){
+
+            case OP_JAL: pending = CALL; pending_target = instr.immediate | (pc & 0xF0000000); pending_return = pc + 8; break;
+            case OP_JALR: pending = CALL; pending_target = registers.read_reg(instr.rs); pending_return = pc + 8; break;
+
+            case OP_BGEZAL: case OP_BLTZAL:
+
+                if(mips_branch_taken(instr, registers)){
+                    pending = CALL;
+                    pending_target = pc + instr.immediate;
+                    pending_return = pc + 8;
+                }
+                break;
+
+            case OP_JR:
+
+                if(instr.rs == 31){
+                    pending = RETURN;
+                    pending_target = registers.read_reg(31);
+                }
+                break;
+
+            default: break;
+        }
+    }
+
+    //"function,address,calls,self,inclusive" for every function called (and the entry), by inclusive count. Recursive calls only count
+    //once in inclusive. Names from symbols, addresses in hex without
+    void report_functions(std::ostream& out, const std::vector<mips_symbol>& symbols) const;
+
+    //collapsed stacks of the whole run, with the instructions each path ran itself, for flamegraph tools
+    void report_collapsed(std::ostream& out, const std::vector<mips_symbol>& symbols) const;
+
+    private:
+
+    enum pending_kind{ NONE, CALL, RETURN };
+
+    struct frame{
+
+        uint32_t node;
+        uint32_t return_address;
+    };
+
+    void finish_pending();
+
+    //the node for calling target from parent, made the first time
+    uint32_t node_for(uint32_t parent, uint32_t target);
+
+    //nodes are indexed, a parent always comes before its children
+    std::vector<uint32_t> node_function; //the address it was called at
+    std::vector<uint32_t> node_parent;
+    std::vector<uint64_t> node_self;
+    std::vector<uint64_t> node_calls;
+
+    std::unordered_map<uint64_t, uint32_t> children; //parent << 32 | target -> node
+
+    std::unique_ptr<frame[]> stack;
+    size_t depth;
+    size_t max_depth;
+    uint64_t overflow; //calls deeper than max_depth that haven't returned
+
+    uint64_t* self; //the count of the node on top of the stack
+
+    pending_kind pending;
+    uint32_t pending_target;
+    uint32_t pending_return;
+};
+
+#endif
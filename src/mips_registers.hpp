@@ -1,7 +1,10 @@
 #ifndef MIPS_REGISTERS
 #define MIPS_REGISTERS
 
-#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+//everything that runs once per instruction is defined in here, so it gets inlined into the handlers and engines
 
 class mips_registers{ // mips has 32 registers
 
@@ -10,35 +13,55 @@ public:
   //constructor
   mips_registers();
 
+  //back to the starting state: every register, HI and LO are 0 and the PC is 0x10000000
+  void reset();
+
   //functions for hi and lo
 
-  uint32_t read_hi();
-  uint32_t read_lo();
+  uint32_t read_hi() const{ return HI; }
+  uint32_t read_lo() const{ return LO; }
 
-  void write_hi(uint32_t input);
-  void write_lo(uint32_t input);
+  void write_hi(uint32_t input){ HI = input; }
+  void write_lo(uint32_t input){ LO = input; }
 
   //things to deal with pc
 
-  uint32_t read_pc();
+  uint32_t read_pc() const{ return PC; }
 
   //ok so here we have 2 instructions for the program counter, one that just adds 4 for next instruction
   //but the other one is one in case of branches and jumps
 
-  void next_instruction_normal();
-  void next_instruction_branch(uint32_t next);
+  void next_instruction_normal(){ PC = PC + 4; }
+  void next_instruction_branch(uint32_t next){ PC = next; }
+
+  //taken branches: the PC stays on the branch while its delay slot runs, and goes to next after it (see instruction_delay_slot)
+  void delay_branch(uint32_t next){ delay_slot = true; delay_target = next; }
+  bool in_delay_slot() const{ return delay_slot; }
+  uint32_t read_delay_target() const{ return delay_target; }
+  void end_delay_slot(){ delay_slot = false; }
 
   //generic read and write for all registers
-  uint32_t read_reg(const uint8_t& index) const; //corresponds to register number, index in array
-  void write_reg(uint8_t index, uint32_t data);
+  uint32_t read_reg(uint8_t index) const{ return registers[index]; } //corresponds to register number, index in array
+
+  //$0 is hard-wired: the write always happens and $0 is put back straight after, which is cheaper than checking the index
+  void write_reg(uint8_t index, uint32_t data){ registers[index] = data; registers[0] = 0; }
+
+  //pointer to the 32 registers, for the JIT which reads and writes them directly (it never writes $0)
+  uint32_t* reg_pointer(){ return registers; }
+
+  //where the PC is from reg_pointer(), in bytes, for the JIT to put it on an instruction that traps
+  static size_t pc_offset(){ return offsetof(mips_registers, PC) - offsetof(mips_registers, registers); }
 
 
 private:
 
-  std::vector<uint32_t> registers;
+  uint32_t registers[32];
 
   uint32_t PC; //Program counter. Starts out with 0x10000000 and shows the absolute location in memory
-  
+
+  bool delay_slot; //the instruction after the PC is a delay slot that still has to run
+  uint32_t delay_target; //where the PC goes after it
+
   uint32_t HI; //high and low hold or accumulate the results of multiplication and addition
   uint32_t LO;
 };
@@ -0,0 +1,566 @@
+#include <algorithm>
+#include <csetjmp>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "mips_simulator.hpp"
+#include "mips_devices.hpp"
+
+mips_simulator::mips_simulator(mips_engine engine_in){
+
+    engine = engine_in;
+    touched = false;
+    trace = NULL;
+    mix = NULL;
+    calls = NULL;
+    timing = NULL;
+    caches = NULL;
+
+    program = std::make_shared<const std::vector<mips_decoded> >();
+
+    entry = 0x10000000;
+    symbols = std::make_shared<const std::vector<mips_symbol> >();
+}
+
+bool mips_simulator::load(const char* image, uint32_t size){
+
+    if(size > 0x1000000){ //if the binary is too big
+        return false;
+    }
+
+    memory.set_INSTR_SIZE(size);
+    memory.copy_ADDR_INSTR(image);
+
+    entry = 0x10000000;
+    symbols = std::make_shared<const std::vector<mips_symbol> >();
+
+    binary_loaded();
+
+    return true;
+}
+
+void mips_simulator::binary_loaded(){
+
+    memory.clear_DATA(); //even if nothing ran, the new binary may come with data
+
+    //decode the whole binary once, so the engines never have to fetch and split an instruction again
+    program = std::make_shared<const std::vector<mips_decoded> >(program_decode(memory));
+
+    //anything found or translated belongs to the old binary
+    blocks.clear();
+    jit.clear();
+
+    start();
+    touched = false;
+}
+
+void mips_simulator::start(){
+
+    registers.reset();
+    registers.next_instruction_branch(entry);
+
+    memory.reset_devices();
+}
+
+void mips_simulator::load_shared(const mips_simulator& source){
+
+    if(program == source.program){ //already running it, keep what the engines found
+        reset();
+        return;
+    }
+
+    memory.share_ADDR_INSTR(source.memory);
+    memory.clear_DATA();
+
+    program = source.program;
+    entry = source.entry;
+    symbols = source.symbols;
+
+    blocks.clear();
+    jit.clear();
+
+    start();
+    touched = false;
+}
+
+bool mips_simulator::load_file(const std::string& location){
+
+    //mapped, not copied: only the decoding reads it, and loads from ADDR_INSTR if there are any
+    std::shared_ptr<const uint8_t> file;
+    size_t size;
+
+    if(!mips_map_file(location, file, size)){
+        return false;
+    }
+
+    //a .bin can't start with the ELF magic: 0x7F454C46 is not an instruction, such a binary could only ever stop with -12
+    if(elf_is_elf(file.get(), size)){
+        return load_elf(file, size);
+    }
+
+    if(size > 0x1000000){ //if the binary is too big
+        return false;
+    }
+
+    memory.set_ADDR_INSTR(file, size);
+
+    entry = 0x10000000;
+    symbols = std::make_shared<const std::vector<mips_symbol> >();
+
+    binary_loaded();
+
+    return true;
+}
+
+bool mips_simulator::load_data_image(const std::string& location, uint32_t address){
+
+    std::shared_ptr<const uint8_t> file;
+    size_t size;
+
+    if(!mips_map_file(location, file, size)){
+        return false;
+    }
+
+    if(address < 0x20000000 || (uint64_t)address + size > 0x24000000){ //it has to fit in ADDR_DATA
+        return false;
+    }
+
+    mips_data_segment segment;
+    segment.address = address;
+    segment.bytes = file;
+    segment.size = size;
+
+    memory.add_DATA_IMAGE(segment);
+
+    memory.clear_DATA();
+    touched = false;
+
+    return true;
+}
+
+bool mips_simulator::load_elf(const std::shared_ptr<const uint8_t>& file, size_t size){
+
+    mips_elf elf;
+
+    if(!elf_parse(file.get(), size, elf)){
+        return false;
+    }
+
+    if(elf.entry < 0x10000000 || elf.entry >= 0x11000000 || (elf.entry & 3) != 0){
+        return false;
+    }
+
+    std::shared_ptr<const uint8_t> image;
+    uint32_t image_size = 0;
+
+    if(elf.instr.size() == 1 && elf.instr[0].address == 0x10000000 && elf.instr[0].file_size == elf.instr[0].memory_size){
+
+        //the usual case, just .text at the start of ADDR_INSTR: it is used where it is in the mapped file, which stays mapped as long as it is
+        image = std::shared_ptr<const uint8_t>(file, file.get() + elf.instr[0].file_offset);
+        image_size = elf.instr[0].file_size;
+    }
+    else if(!elf.instr.empty()){
+
+        //put together from the segments, with zeros around them
+        for(size_t i = 0; i < elf.instr.size(); i++){
+            image_size = std::max(image_size, elf.instr[i].address + elf.instr[i].memory_size - 0x10000000);
+        }
+
+        uint8_t* copy = new uint8_t[image_size]();
+
+        for(size_t i = 0; i < elf.instr.size(); i++){
+            std::memcpy(copy + elf.instr[i].address - 0x10000000, file.get() + elf.instr[i].file_offset, elf.instr[i].file_size);
+        }
+
+        image = std::shared_ptr<const uint8_t>(copy, std::default_delete<const uint8_t[]>());
+    }
+
+    memory.set_ADDR_INSTR(image, image_size);
+
+    //the data stays in the mapped file too, ADDR_DATA has its pages until the program writes them (see clear_DATA).
+    //only the bytes in the file, the .bss after them is 0 anyway
+    for(size_t i = 0; i < elf.data.size(); i++){
+
+        mips_data_segment segment;
+        segment.address = elf.data[i].address;
+        segment.bytes = std::shared_ptr<const uint8_t>(file, file.get() + elf.data[i].file_offset);
+        segment.size = elf.data[i].file_size;
+
+        memory.add_DATA_IMAGE(segment);
+    }
+
+    entry = elf.entry;
+    symbols = std::make_shared<const std::vector<mips_symbol> >(elf.symbols);
+
+    binary_loaded();
+
+    return true;
+}
+
+mips_status mips_simulator::run(uint64_t max_steps){
+
+    touched = true;
+
+    if(!memory.guard_pages()){
+        return run_engine(max_steps);
+    }
+
+    //a load or store outside ADDR_INSTR/ADDR_DATA faults in the host, and the fault handler comes back here.
+    //the PC is still on the instruction that faulted, nothing it would have written has been written
+    sigjmp_buf fault;
+
+    if(sigsetjmp(fault, 1) != 0){
+        mips_guard_leave();
+        return MIPS_MEMORY_TRAP;
+    }
+
+    mips_guard_enter(memory, &fault);
+
+    mips_status status = run_engine(max_steps);
+
+    mips_guard_leave();
+
+    return status;
+}
+
+mips_status mips_simulator::run_engine(uint64_t max_steps){
+
+    uint64_t steps = max_steps;
+
+    //more than one instrumenting policy: all of them in one loop, each before() hook for every instruction
+    if((trace != NULL) + (mix != NULL) + (calls != NULL) + (timing != NULL) + (caches != NULL) > 1){
+
+        std::unique_ptr<mips_policy_trace> trace_hooks(trace != NULL ? new mips_policy_trace(*trace) : NULL);
+        std::unique_ptr<mips_policy_mix> mix_hooks(mix != NULL ? new mips_policy_mix(*mix) : NULL);
+        std::unique_ptr<mips_policy_calls> calls_hooks(calls != NULL ? new mips_policy_calls(*calls) : NULL);
+        std::unique_ptr<mips_policy_timing> timing_hooks(timing != NULL ? new mips_policy_timing(*timing) : NULL);
+        std::unique_ptr<mips_policy_cache> cache_hooks(caches != NULL ? new mips_policy_cache(*caches) : NULL);
+
+        typedef mips_policy_optional<mips_policy_trace> trace_on;
+        typedef mips_policy_optional<mips_policy_mix> mix_on;
+        typedef mips_policy_optional<mips_policy_calls> calls_on;
+        typedef mips_policy_optional<mips_policy_timing> timing_on;
+        typedef mips_policy_optional<mips_policy_cache> cache_on;
+
+        mips_policy_every hooks = mips_policy_join(trace_on(trace_hooks.get()), mips_policy_join(mix_on(mix_hooks.get()),
+            mips_policy_join(calls_on(calls_hooks.get()), mips_policy_join(timing_on(timing_hooks.get()), cache_on(cache_hooks.get())))));
+
+        return program_run_threaded(*program, memory, registers, steps, hooks);
+    }
+
+    if(trace != NULL){
+        mips_policy_trace hooks(*trace);
+        return program_run_threaded(*program, memory, registers, steps, hooks);
+    }
+
+    if(mix != NULL){
+        mips_policy_mix hooks(*mix);
+        return program_run_threaded(*program, memory, registers, steps, hooks);
+    }
+
+    if(calls != NULL){
+        mips_policy_calls hooks(*calls);
+        return program_run_threaded(*program, memory, registers, steps, hooks);
+    }
+
+    if(timing != NULL){
+        mips_policy_timing hooks(*timing);
+        return program_run_threaded(*program, memory, registers, steps, hooks);
+    }
+
+    if(caches != NULL){
+        mips_policy_cache hooks(*caches);
+        return program_run_threaded(*program, memory, registers, steps, hooks);
+    }
+
+    //no budget: the step loops are compiled without the counting
+    bool unlimited = (max_steps == UINT64_MAX);
+
+    if(engine == ENGINE_BLOCKS){
+        return blocks.run(*program, memory, registers, steps);
+    }
+    else if(engine == ENGINE_JIT){
+        return jit.run(*program, memory, registers, steps);
+    }
+    else if(engine == ENGINE_THREADED){
+
+        if(unlimited){
+            mips_policy_unlimited hooks;
+            return program_run_threaded(*program, memory, registers, steps, hooks);
+        }
+        return program_run_threaded(*program, memory, registers, steps);
+    }
+    else{
+
+        if(unlimited){
+            mips_policy_unlimited hooks;
+            return program_run_table(*program, memory, registers, steps, hooks);
+        }
+        return program_run_table(*program, memory, registers, steps);
+    }
+}
+
+void mips_simulator::reset(){
+
+    if(touched){
+        memory.clear_DATA();
+    }
+
+    start();
+    touched = false;
+}
+
+mips_snapshot mips_simulator::snapshot(){
+
+    mips_snapshot snapshot;
+
+    snapshot.registers = registers;
+    snapshot.data = memory.snapshot_DATA();
+    snapshot.program = program;
+
+    return snapshot;
+}
+
+bool mips_simulator::restore(const mips_snapshot& snapshot){
+
+    if(snapshot.program != program){
+        return false;
+    }
+
+    registers = snapshot.registers;
+    memory.restore_DATA(snapshot.data);
+
+    touched = true; //ADDR_DATA is not zeroed
+
+    return true;
+}
+
+//checkpoint files are big endian like everything else here:
+//"MIPSCKPT", version, binary size and hash, PC, HI, LO, delay slot and its target, $1 to $31, the number of pages, then every page as its address and 4 KiB
+static const char CHECKPOINT_MAGIC[8] = {'M', 'I', 'P', 'S', 'C', 'K', 'P', 'T'};
+static const uint32_t CHECKPOINT_VERSION = 1;
+
+static void checkpoint_put(std::ostream& out, uint32_t word){
+
+    char bytes[4] = {(char)(word >> 24), (char)(word >> 16), (char)(word >> 8), (char)word};
+    out.write(bytes, 4);
+}
+
+static uint32_t checkpoint_get(std::istream& in){
+
+    unsigned char bytes[4] = {0, 0, 0, 0};
+    in.read((char*)bytes, 4);
+
+    return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) | bytes[3];
+}
+
+uint32_t mips_simulator::binary_hash(){
+
+    //FNV-1a over the words of the binary
+    uint32_t hash = 2166136261u;
+
+    for(uint32_t i = 0; i < memory.read_INSTR_SIZE(); i += 4){
+        hash = (hash ^ memory.read_INSTR(0x10000000 + i)) * 16777619u;
+    }
+
+    return hash;
+}
+
+bool mips_simulator::save_checkpoint(const std::string& location){
+
+    mips_snapshot state = snapshot();
+
+    //only the pages with something in them
+    std::vector<std::pair<uint32_t, const mips_data_page*> > pages;
+
+    for(uint32_t i = 0; i < 0x40; i++){
+
+        if(!state.data->ADDR_DATA[i]){
+            continue;
+        }
+
+        for(uint32_t j = 0; j < 0x100; j++){
+
+            const mips_data_page* page = state.data->ADDR_DATA[i]->pages[j].get();
+
+            if(page != NULL && std::any_of(page->bytes, page->bytes + 0x1000, [](uint8_t byte){ return byte != 0; })){
+                pages.push_back(std::make_pair(0x20000000 + (i << 20) + (j << 12), page));
+            }
+        }
+    }
+
+    std::ofstream out(location, std::ios::binary);
+
+    out.write(CHECKPOINT_MAGIC, 8);
+    checkpoint_put(out, CHECKPOINT_VERSION);
+    checkpoint_put(out, memory.read_INSTR_SIZE());
+    checkpoint_put(out, binary_hash());
+
+    checkpoint_put(out, state.registers.read_pc());
+    checkpoint_put(out, state.registers.read_hi());
+    checkpoint_put(out, state.registers.read_lo());
+    checkpoint_put(out, state.registers.in_delay_slot());
+    checkpoint_put(out, state.registers.read_delay_target());
+
+    for(uint8_t i = 1; i < 32; i++){
+        checkpoint_put(out, state.registers.read_reg(i));
+    }
+
+    checkpoint_put(out, pages.size());
+
+    for(size_t i = 0; i < pages.size(); i++){
+
+        checkpoint_put(out, pages[i].first);
+        out.write((const char*)pages[i].second->bytes, 0x1000);
+    }
+
+    out.close(); //so a failed write shows
+
+    return !out.fail();
+}
+
+bool mips_simulator::load_checkpoint(const std::string& location){
+
+    std::ifstream in(location, std::ios::binary);
+
+    char magic[8];
+    in.read(magic, 8);
+
+    if(!in || std::memcmp(magic, CHECKPOINT_MAGIC, 8) != 0 || checkpoint_get(in) != CHECKPOINT_VERSION){
+        return false;
+    }
+
+    uint32_t size = checkpoint_get(in);
+
+    if(!in || size != memory.read_INSTR_SIZE() || checkpoint_get(in) != binary_hash()){
+        return false;
+    }
+
+    mips_snapshot state;
+    state.program = program;
+
+    state.registers.next_instruction_branch(checkpoint_get(in));
+    state.registers.write_hi(checkpoint_get(in));
+    state.registers.write_lo(checkpoint_get(in));
+
+    bool delay_slot = checkpoint_get(in) != 0;
+    uint32_t delay_target = checkpoint_get(in);
+
+    if(delay_slot){
+        state.registers.delay_branch(delay_target);
+    }
+
+    for(uint8_t i = 1; i < 32; i++){
+        state.registers.write_reg(i, checkpoint_get(in));
+    }
+
+    std::shared_ptr<mips_data_snapshot> data = std::make_shared<mips_data_snapshot>();
+
+    uint32_t count = checkpoint_get(in);
+
+    for(uint32_t i = 0; i < count && in; i++){
+
+        uint32_t address = checkpoint_get(in);
+
+        if(address < 0x20000000 || address >= 0x24000000 || (address & 0xFFF) != 0){
+            return false;
+        }
+
+        uint32_t offset = address - 0x20000000;
+
+        std::unique_ptr<mips_data_table>& table = data->ADDR_DATA[offset >> 20];
+
+        if(!table){
+            table.reset(new mips_data_table());
+        }
+
+        std::shared_ptr<mips_data_page>& page = table->pages[(offset >> 12) & 0xFF];
+
+        page = std::make_shared<mips_data_page>();
+        in.read((char*)page->bytes, 0x1000);
+    }
+
+    if(!in){ //cut short
+        return false;
+    }
+
+    state.data = data;
+
+    return restore(state);
+}
+
+mips_registers& mips_simulator::get_registers(){
+
+    return registers;
+}
+
+const std::vector<mips_symbol>& mips_simulator::get_symbols() const{
+
+    return *symbols;
+}
+
+bool mips_simulator::set_guard_pages(bool on){
+
+    touched = false; //switching clears ADDR_DATA
+
+    return memory.set_guard_pages(on);
+}
+
+void mips_simulator::set_trace(std::ostream* out){
+
+    trace = out;
+}
+
+void mips_simulator::set_profile_mix(mips_mix* mix_in){
+
+    mix = mix_in;
+}
+
+void mips_simulator::set_profile_calls(mips_callgraph* calls_in){
+
+    calls = calls_in;
+}
+
+void mips_simulator::set_caches(mips_caches* caches_in){
+
+    caches = caches_in;
+}
+
+void mips_simulator::set_timing(mips_timing* timing_in){
+
+    timing = timing_in;
+
+    if(timing != NULL){
+        memory.attach_device(0x30000008, std::unique_ptr<mips_device>(new mips_cycle_device(*timing)));
+    }
+    else{
+        memory.detach_device(0x30000008);
+    }
+}
+
+mips_memory& mips_simulator::get_memory(){
+
+    touched = true; //the caller can write to it
+
+    return memory;
+}
+
+int mips_exit_code(mips_status status, mips_registers& registers){
+
+    switch(status){
+
+        case MIPS_EXITED: return (uint8_t)registers.read_reg(2);
+
+        case MIPS_ARITHMETIC_TRAP: return -10;
+        case MIPS_MEMORY_TRAP: return -11;
+        case MIPS_INVALID_INSTRUCTION: return -12;
+        case MIPS_IO_ERROR: return -21;
+
+        default: return 0;
+    }
+}
@@ -0,0 +1,153 @@
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "mips_elf.hpp"
+#include "mips_memory.hpp"
+#include "mips_registers.hpp"
+#include "mips_breakdown.hpp"
+#include "mips_policy.hpp"
+#include "mips_blocks.hpp"
+#include "mips_jit.hpp"
+
+#ifndef MIPS_SIMULATOR
+#define MIPS_SIMULATOR
+
+//which engine run() uses. They all give the same results, they just get there at different speeds
+enum mips_engine{ ENGINE_BLOCKS, ENGINE_JIT, ENGINE_THREADED, ENGINE_TABLE };
+
+//the state of a program at some point of a run, from mips_simulator::snapshot(). Read only, restoring it doesn't change it,
+//so one snapshot can be restored any number of times, by any number of simulators running the same binary
+struct mips_snapshot{
+
+    mips_registers registers;
+    std::shared_ptr<const mips_data_snapshot> data;
+    std::shared_ptr<const std::vector<mips_decoded> > program; //the binary it is of
+};
+
+//the simulator as a library: one binary loaded into its own memory and registers, run for as long as the caller wants.
+//nothing in here calls exit(), a program that stops makes run() return why. The memory is allocated once, load() and reset() reuse it,
+//so one process can run as many programs (or as many simulators side by side) as it wants
+class mips_simulator{
+
+    public:
+
+    mips_simulator(mips_engine engine_in = ENGINE_BLOCKS);
+
+    //loads a binary into ADDR_INSTR and resets everything else. Returns false if it is bigger than ADDR_INSTR
+    bool load(const char* image, uint32_t size);
+
+    //same as load, reading the binary from a file. Also returns false if the file can't be read.
+    //the file can also be a linked .mips.elf: its segments go into ADDR_INSTR and ADDR_DATA (.data starts out as in the file, .bss as 0),
+    //and the program starts at its entry point. False if it is not a MIPS executable that fits the memory map (see elf_parse)
+    bool load_file(const std::string& location);
+
+    //puts a host file in ADDR_DATA at address, for the program to read (and write) like any other memory. It is mapped, not read, and a page of it is
+    //only copied when the program writes to it, so a reset puts it back for nothing. Like the .data of an ELF it is part of the loaded binary (from now until the
+    //next load) and resets ADDR_DATA. False if the file can't be mapped or doesn't fit in ADDR_DATA
+    bool load_data_image(const std::string& location, uint32_t address = 0x20000000);
+
+    //loads the binary source has loaded, sharing its image and decoded program instead of copying them. Anything else is reset.
+    //source must not load another binary while this one runs. If it is the binary already loaded this is the same as reset()
+    void load_shared(const mips_simulator& source);
+
+    //runs from where the last run stopped until the program stops, or max_steps instructions have run (MIPS_STEP_LIMIT, calling it again continues).
+    //every instruction is one step, a delay slot too
+    mips_status run(uint64_t max_steps = UINT64_MAX);
+
+    //the registers and ADDR_DATA as they are now, after load() or between two run()s. Taking it costs the pages in use as pointers (their contents are
+    //shared, a page is only copied when the program writes it next)
+    mips_snapshot snapshot();
+
+    //back to where the program was when snapshot was taken, so it continues from there. Only costs the pages written since this simulator last
+    //took or restored snapshot (the first time, or in guard page mode, it costs the pages in use). False if the snapshot is of another binary.
+    //GETC/PUTC are not in it, set_io to give the run its input again
+    bool restore(const mips_snapshot& snapshot);
+
+    //writes the state of the program (registers and the ADDR_DATA pages that are not all 0) to a file, so a later run of the same binary can
+    //carry on from here with load_checkpoint() instead of running up to it again. False if the file can't be written
+    bool save_checkpoint(const std::string& location);
+
+    //carries on from a checkpoint save_checkpoint() wrote (like restore()). False if the file can't be read, is not a checkpoint or is of another binary,
+    //nothing changes then. What GETC read before the checkpoint is not in it, the input has to start after that
+    bool load_checkpoint(const std::string& location);
+
+    //back to how it was right after load(): registers and ADDR_DATA zeroed (but for the .data of an ELF), PC at the entry point. The binary (and anything translated from it) is kept
+    void reset();
+
+    //the registers and memory of the program, to look at it after a run or set it up before one
+    mips_registers& get_registers();
+    mips_memory& get_memory();
+
+    //the functions and objects of the ELF file that was loaded, empty for a .bin (or a stripped ELF)
+    const std::vector<mips_symbol>& get_symbols() const;
+
+    //guard page mode for the memory (see mips_memory::set_guard_pages): loads and stores without region checks, a fault stops the run with
+    //MIPS_MEMORY_TRAP instead. Returns false if the host can't do it. Clears ADDR_DATA, so it is for before a run
+    bool set_guard_pages(bool on);
+
+    //prints every instruction to out before it runs (see mips_policy_trace), NULL to stop. Tracing always uses the threaded engine, the others don't see every instruction
+    void set_trace(std::ostream* out);
+
+    //counts the instruction mix of every run into mix (see mips_policy_mix) until it is set back to NULL. Like tracing it uses the threaded engine,
+    //at a few times slower than the fastest one
+    void set_profile_mix(mips_mix* mix);
+
+    //the same for an exact call graph (see mips_callgraph)
+    void set_profile_calls(mips_callgraph* calls);
+
+    //runs the timing model every run (on the threaded engine), and puts its cycle count at 0x30000008 for the program
+    //to read (see mips_cycle_device). A reset starts it at cycle 0 again. NULL takes it out, the counter traps then like before
+    void set_timing(mips_timing* timing);
+
+    //runs L1 caches every run (see mips_caches). NULL to stop
+    void set_caches(mips_caches* caches);
+
+    //any of the five above can be on together: they all see every instruction, in one loop (mips_policy_every), a little slower than one alone
+
+    private:
+
+    //resets everything for the binary that was just put in memory, and decodes it
+    void binary_loaded();
+
+    //load_file() for an ELF file, file is the whole of it mapped
+    bool load_elf(const std::shared_ptr<const uint8_t>& file, size_t size);
+
+    //registers (and the devices') back to 0, PC on the entry point
+    void start();
+
+    //tells binaries apart, for checkpoints
+    uint32_t binary_hash();
+
+    //run() without the guard page fault handling around it
+    mips_status run_engine(uint64_t max_steps);
+
+    mips_engine engine;
+
+    mips_memory memory;
+    mips_registers registers;
+
+    std::shared_ptr<const std::vector<mips_decoded> > program; //the binary decoded once by load(), read only so simulators can share it
+
+    uint32_t entry; //where the PC starts, 0x10000000 but for an ELF
+    std::shared_ptr<const std::vector<mips_symbol> > symbols;
+
+    mips_block_engine blocks;
+    mips_jit jit;
+
+    bool touched; //ADDR_DATA may have been written since it was last zeroed
+
+    std::ostream* trace; //where set_trace() prints to, NULL if off
+    mips_mix* mix;       //what set_profile_mix() counts into, NULL if off
+    mips_callgraph* calls;
+    mips_timing* timing;
+    mips_caches* caches;
+};
+
+//the process exit code the command line simulator uses for a status: the bottom byte of $2 when the program exited,
+//-10/-11/-12/-21 for the traps and errors (as in the spec). MIPS_OK and MIPS_STEP_LIMIT are not a stop, they give 0
+int mips_exit_code(mips_status status, mips_registers& registers);
+
+#endif
@@ -0,0 +1,19 @@
+#ifndef MIPS_STATUS
+#define MIPS_STATUS
+
+//why running stopped. Handlers, memory accesses and the engines return this instead of calling exit(),
+//so one process can run as many programs as it likes. mips_simulator turns it into the exit codes from the spec
+enum mips_status{
+
+    MIPS_OK = 0,              //nothing happened, carry on with the next instruction
+
+    MIPS_EXITED,              //jumped to 0x0, the exit code is the bottom byte of $2
+    MIPS_ARITHMETIC_TRAP,     //-10
+    MIPS_MEMORY_TRAP,         //-11
+    MIPS_INVALID_INSTRUCTION, //-12
+    MIPS_IO_ERROR,            //-21
+
+    MIPS_STEP_LIMIT           //the step budget given to run() was used up, calling run() again continues
+};
+
+#endif
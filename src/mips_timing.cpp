@@ -0,0 +1,96 @@
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+
+#include "mips_timing.hpp"
+
+//indexed by mips_handler, has to stay in the same order as the enum
+const uint8_t mips_timing::timing_uses[OP_JAL + 1] = {
+
+    0, //invalid
+
+    //R type
+    USES_RS | USES_RT,                 //addu
+    USES_RS | JUMPS,                   //jr
+    USES_RS | USES_RT,                 //add
+    USES_RS | USES_RT,                 //and
+    USES_RS | USES_RT | HILO,          //div
+    USES_RS | USES_RT | HILO,          //divu
+    USES_RS | JUMPS,                   //jalr
+    HILO,                              //mfhi
+    HILO,                              //mflo
+    USES_RS | HILO,                    //mthi
+    USES_RS | HILO,                    //mtlo
+    USES_RS | USES_RT | HILO,          //mult
+    USES_RS | USES_RT | HILO,          //multu
+    USES_RS | USES_RT,                 //or
+    USES_RT,                           //sll
+    USES_RS | USES_RT,                 //sllv
+    USES_RS | USES_RT,                 //slt
+    USES_RS | USES_RT,                 //sltu
+    USES_RT,                           //sra
+    USES_RS | USES_RT,                 //srav
+    USES_RT,                           //srl
+    USES_RS | USES_RT,                 //srlv
+    USES_RS | USES_RT,                 //sub
+    USES_RS | USES_RT,                 //subu
+    USES_RS | USES_RT,                 //xor
+
+    //I type
+    0,                                 //lui
+    USES_RS,                           //addiu
+    USES_RS | USES_RT,                 //sw
+    USES_RS | LOADS,                   //lw
+    USES_RS,                           //ori
+    USES_RS | USES_RT | BRANCHES,      //bne
+    USES_RS,                           //addi
+    USES_RS,                           //andi
+    USES_RS | USES_RT | BRANCHES,      //beq
+    USES_RS | BRANCHES,                //bgez
+    USES_RS | BRANCHES,                //bgezal
+    USES_RS | BRANCHES,                //bgtz
+    USES_RS | BRANCHES,                //blez
+    USES_RS | BRANCHES,                //bltz
+    USES_RS | BRANCHES,                //bltzal
+    USES_RS | LOADS,                   //lb
+    USES_RS | LOADS,                   //lbu
+    USES_RS | LOADS,                   //lh
+    USES_RS | LOADS,                   //lhu
+    USES_RS | USES_RT | LOADS,         //lwl (merges into rt)
+    USES_RS | USES_RT | LOADS,         //lwr
+    USES_RS | USES_RT,                 //sb
+    USES_RS | USES_RT,                 //sh
+    USES_RS,                           //slti
+    USES_RS,                           //sltiu
+    USES_RS,                           //xori
+
+    //J type
+    JUMPS,                             //j
+    JUMPS                              //jal
+};
+
+mips_timing::mips_timing(const mips_timing_config& config_in) : config(config_in){
+
+    reset();
+}
+
+void mips_timing::reset(){
+
+    cycles = 0;
+    instructions = 0;
+    load_use_stalls = 0;
+    hilo_stalls = 0;
+    branch_stalls = 0;
+
+    hilo_ready = 0;
+    loaded = 0;
+}
+
+void mips_timing::report(std::ostream& out) const{
+
+    char cpi[32];
+    std::snprintf(cpi, sizeof(cpi), "%.3f", (instructions > 0) ? (double)cycles / instructions : 0.0);
+
+    out << "cycles,instructions,cpi,load_use_stalls,hilo_stalls,branch_stalls\n";
+    out << cycles << "," << instructions << "," << cpi << "," << load_use_stalls << "," << hilo_stalls << "," << branch_stalls << "\n";
+}
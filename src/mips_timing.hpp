@@ -0,0 +1,97 @@
+#include <cstdint>
+#include <ostream>
+
+#include "mips_breakdown.hpp"
+#include "mips_registers.hpp"
+
+#ifndef MIPS_TIMING
+#define MIPS_TIMING
+
+//the cycles of a classic 5 stage MIPS I pipeline (IF ID EX MEM WB), roughly: every instruction issues in one cycle, plus
+//  load use   a load followed straight away by an instruction that reads what it loaded (the value is only there after MEM)
+//  branches   a taken branch or jump refetches from its target after the delay slot. On the R3000 the branch resolves in ID and the delay
+//             slot hides the refetch, so that costs nothing; a deeper fetch (or a core without the slot) can set a penalty
+//  HI/LO      MULT/MULTU/DIV/DIVU run on their own unit for a number of cycles, MFHI/MFLO (or the next one of them) wait for it
+//the penalties are configurable, the defaults are the R3000's
+struct mips_timing_config{
+
+    uint32_t load_use;       //cycles a load use stalls
+    uint32_t branch_penalty; //cycles lost on a taken branch, after its delay slot
+    uint32_t mult_latency;   //MULT/MULTU until HI/LO are ready
+    uint32_t div_latency;    //DIV/DIVU
+
+    mips_timing_config() : load_use(1), branch_penalty(0), mult_latency(12), div_latency(35) {}
+};
+
+//the timing model, run on every instruction by mips_policy_timing (see mips_simulator::set_timing). It only looks at the instruction and
+//the registers before it runs, nothing functional knows about it, and with no model set none of this is compiled into the engines that run
+class mips_timing{
+
+    public:
+
+    mips_timing(const mips_timing_config& config_in = mips_timing_config());
+
+    //back to cycle 0, for a new run
+    void reset();
+
+    void before(const mips_decoded& instr, uint32_t, const mips_registers& registers){
+
+        uint8_t uses = timing_uses[instr.handler];
+
+        cycles++;
+        instructions++;
+
+        //the load just before this one has its value after MEM, a cycle too late for this one's EX
+        if(loaded != 0 && (((uses & USES_RS) && instr.rs == loaded) || ((uses & USES_RT) && instr.rt == loaded))){
+            cycles += config.load_use;
+            load_use_stalls += config.load_use;
+        }
+
+        loaded = (uses & LOADS) ? instr.rt : 0; //$0 never stalls
+
+        if(uses & HILO){
+
+            if(cycles < hilo_ready){ //the unit is still busy with the last one
+                hilo_stalls += hilo_ready - cycles;
+                cycles = hilo_ready;
+            }
+
+            if(instr.handler == OP_MULT || instr.handler == OP_MULTU){
+                hilo_ready = cycles + config.mult_latency;
+            }
+            else if(instr.handler == OP_DIV || instr.handler == OP_DIVU){
+                hilo_ready = cycles + config.div_latency;
+            }
+        }
+
+        if((uses & JUMPS) || ((uses & BRANCHES) && mips_branch_taken(instr, registers))){
+            cycles += config.branch_penalty;
+            branch_stalls += config.branch_penalty;
+        }
+    }
+
+    uint64_t read_cycles() const{ return cycles; }
+
+    //"cycles,instructions,cpi,load_use_stalls,hilo_stalls,branch_stalls" and a line of the numbers
+    void report(std::ostream& out) const;
+
+    private:
+
+    //what an instruction does that the model cares about, by handler
+    enum{ USES_RS = 1, USES_RT = 2, LOADS = 4, HILO = 8, BRANCHES = 16, JUMPS = 32 };
+
+    static const uint8_t timing_uses[OP_JAL + 1];
+
+    mips_timing_config config;
+
+    uint64_t cycles;
+    uint64_t instructions;
+    uint64_t load_use_stalls;
+    uint64_t hilo_stalls;
+    uint64_t branch_stalls;
+
+    uint64_t hilo_ready; //the cycle HI/LO are ready
+    uint8_t loaded;      //the register the last instruction loaded, 0 if it wasn't a load
+};
+
+#endif
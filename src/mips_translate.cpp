@@ -0,0 +1,344 @@
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <vector>
+#include <cstdio>
+
+#include "mips_memory.hpp"
+#include "mips_registers.hpp"
+#include "mips_breakdown.hpp"
+#include "mips_elf.hpp"
+
+//Ahead of time translator: turns a .bin into C++ source that runs it natively.
+//Usage: mips_translate input.bin output.cpp
+//The input has to be a .bin: an ELF file (which the simulator can run as it is) exits with -20, pull its .text out first (the %.mips.bin rule).
+//The output has the binary embedded, and is linked against the simulator library (see the %.native rule in the makefile).
+//Every reachable instruction becomes a label, JR/JALR go through a switch on the address, and addresses that were not found
+//reachable (or anything else the translation can't do inline) are handed to the normal handlers / block engine, so the exit codes stay the same.
+
+
+//formats like printf into a std::string
+static std::string format(const char* pattern, uint32_t a = 0, uint32_t b = 0, uint32_t c = 0){
+
+    char text[256];
+    std::snprintf(text, sizeof(text), pattern, a, b, c);
+    return text;
+}
+
+static std::string label(uint32_t index){
+
+    return format("L_%08x", 0x10000000 + 4 * index);
+}
+
+//marks every instruction that can be reached by following the code from 0x10000000 (targets, fall through and return addresses)
+static std::vector<bool> find_reachable(const std::vector<mips_decoded>& program, uint32_t last_index){
+
+    std::vector<bool> reachable(last_index + 1, false);
+    std::vector<uint32_t> work;
+
+    work.push_back(0);
+
+    while(!work.empty()){
+
+        uint32_t index = work.back();
+        work.pop_back();
+
+        if(index > last_index || reachable[index]){
+            continue;
+        }
+
+        reachable[index] = true;
+
+        const mips_decoded& instr = program[index];
+        uint32_t pc = 0x10000000 + 4 * index;
+
+        if(instr.handler == OP_INVALID){
+            continue;
+        }
+
+        if(!instruction_is_branch(instr.handler)){
+            work.push_back(index + 1);
+            continue;
+        }
+
+        //static targets
+        uint32_t target = 0;
+
+        if(instr.handler == OP_J || instr.handler == OP_JAL){
+            target = instr.immediate | (pc & 0xF0000000);
+        }
+        else if(instr.handler != OP_JR && instr.handler != OP_JALR){
+            target = pc + instr.immediate;
+        }
+
+        if(target >= 0x10000000){
+            work.push_back((target - 0x10000000) / 4);
+        }
+
+        //everything but J and JR can fall through (the delay slot), and the linking ones return after the delay slot
+        if(instr.handler != OP_J && instr.handler != OP_JR){
+            work.push_back(index + 1);
+        }
+        if(instr.handler == OP_JAL || instr.handler == OP_JALR || instr.handler == OP_BGEZAL || instr.handler == OP_BLTZAL){
+            work.push_back(index + 2);
+        }
+    }
+
+    return reachable;
+}
+
+//C++ for one instruction that is not a branch
+static std::string translate_simple(const mips_decoded& instr, uint32_t index){
+
+    uint32_t rs = instr.rs;
+    uint32_t rt = instr.rt;
+    uint32_t rd = instr.rd;
+    uint32_t immediate = instr.immediate;
+
+    //destination register of the instruction ($0 writes are dropped)
+    uint32_t destination = (instr.handler <= OP_XOR) ? rd : rt;
+
+    std::string write = format("r[%u] = ", destination);
+
+    switch(instr.handler){
+
+        case OP_ADDU: return destination ? write + format("r[%u] + r[%u];", rs, rt) : "";
+        case OP_SUBU: return destination ? write + format("r[%u] - r[%u];", rs, rt) : "";
+        case OP_AND:  return destination ? write + format("r[%u] & r[%u];", rs, rt) : "";
+        case OP_OR:   return destination ? write + format("r[%u] | r[%u];", rs, rt) : "";
+        case OP_XOR:  return destination ? write + format("r[%u] ^ r[%u];", rs, rt) : "";
+        case OP_SLT:  return destination ? write + format("(int32_t)r[%u] < (int32_t)r[%u];", rs, rt) : "";
+        case OP_SLTU: return destination ? write + format("r[%u] < r[%u];", rs, rt) : "";
+
+        case OP_SLL:  return destination ? write + format("r[%u] << %u;", rt, immediate) : "";
+        case OP_SRL:  return destination ? write + format("r[%u] >> %u;", rt, immediate) : "";
+        case OP_SRA:  return destination ? write + format("(uint32_t)((int32_t)r[%u] >> %u);", rt, immediate) : "";
+        case OP_SLLV: return destination ? write + format("r[%u] << (r[%u] & 0x1F);", rt, rs) : "";
+        case OP_SRLV: return destination ? write + format("r[%u] >> (r[%u] & 0x1F);", rt, rs) : "";
+        case OP_SRAV: return destination ? write + format("(uint32_t)((int32_t)r[%u] >> (r[%u] & 0x1F));", rt, rs) : "";
+
+        case OP_LUI:   return destination ? write + format("0x%08xu;", immediate) : "";
+        case OP_ADDIU: return destination ? write + format("r[%u] + 0x%08xu;", rs, immediate) : "";
+        case OP_ANDI:  return destination ? write + format("r[%u] & 0x%08xu;", rs, immediate) : "";
+        case OP_ORI:   return destination ? write + format("r[%u] | 0x%08xu;", rs, immediate) : "";
+        case OP_XORI:  return destination ? write + format("r[%u] ^ 0x%08xu;", rs, immediate) : "";
+        case OP_SLTI:  return destination ? write + format("(int32_t)r[%u] < (int32_t)0x%08xu;", rs, immediate) : "";
+        case OP_SLTIU: return destination ? write + format("r[%u] < 0x%08xu;", rs, immediate) : "";
+
+        //overflow exits with -10 before the destination is written
+        case OP_ADD:  return format("{ uint32_t a = r[%u], b = r[%u], s = a + b; if(((a ^ s) & (b ^ s)) >> 31){ exit(-10); } ", rs, rt) + (destination ? write + "s; }" : "}");
+        case OP_ADDI: return format("{ uint32_t a = r[%u], b = 0x%08xu, s = a + b; if(((a ^ s) & (b ^ s)) >> 31){ exit(-10); } ", rs, immediate) + (destination ? write + "s; }" : "}");
+        case OP_SUB:  return format("{ uint32_t a = r[%u], b = r[%u], s = a - b; if(((a ^ b) & (a ^ s)) >> 31){ exit(-10); } ", rs, rt) + (destination ? write + "s; }" : "}");
+
+        case OP_INVALID: return "exit(-12);";
+
+        //loads, stores, multiply/divide and HI/LO use the normal handlers
+        default: return format("handler(program[%u], program, memory, registers);", index);
+    }
+}
+
+//C++ for going to a static target after a taken branch/jump
+static std::string translate_goto(uint32_t target, uint32_t last_index, const std::vector<bool>& reachable){
+
+    uint32_t index = (target - 0x10000000) / 4;
+
+    if(target == 0){
+        return "exit((uint8_t)r[2]);";
+    }
+    if(target < 0x10000000 || index > last_index || !reachable[index]){
+        return "exit(-11);";
+    }
+    return "goto " + label(index) + ";";
+}
+
+//C++ for a branch/jump and its delay slot
+static std::string translate_branch(const mips_decoded& instr, uint32_t index, const std::vector<mips_decoded>& program, uint32_t last_index, const std::vector<bool>& reachable){
+
+    uint32_t pc = 0x10000000 + 4 * index;
+    bool has_delay_slot = index < last_index; //same as "PC < LAST_INSTR_ADDRESS" in the handlers
+
+    //a delay slot that is itself a branch (invalid when the first one is taken) or an invalid instruction: let the handlers do the whole thing
+    if(has_delay_slot && (program[index + 1].handler == OP_INVALID || instruction_is_branch(program[index + 1].handler))){
+        return format("registers.next_instruction_branch(0x%08xu); handler(program[%u], program, memory, registers); delay_slot(program, memory, registers); pc = registers.read_pc(); goto dispatch;", pc, index);
+    }
+
+    std::string delay_slot = has_delay_slot ? translate_simple(program[index + 1], index + 1) + " " : "";
+    std::string link = format("r[31] = 0x%08xu; ", pc + 8);
+
+    uint32_t rs = instr.rs;
+    uint32_t rt = instr.rt;
+
+    std::string condition;
+
+    switch(instr.handler){
+
+        //(comparing a register with itself is written as a constant, so the compiler doesn't warn)
+        case OP_BEQ: condition = (rs == rt) ? "true" : format("r[%u] == r[%u]", rs, rt); break;
+        case OP_BNE: condition = (rs == rt) ? "false" : format("r[%u] != r[%u]", rs, rt); break;
+        case OP_BGEZ: case OP_BGEZAL: condition = format("(int32_t)r[%u] >= 0", rs); break;
+        case OP_BLTZ: case OP_BLTZAL: condition = format("(int32_t)r[%u] < 0", rs); break;
+        case OP_BGTZ: condition = format("(int32_t)r[%u] > 0", rs); break;
+        case OP_BLEZ: condition = format("(int32_t)r[%u] <= 0", rs); break;
+
+        case OP_J:
+            return delay_slot + translate_goto(instr.immediate | (pc & 0xF0000000), last_index, reachable);
+
+        case OP_JAL:
+            return link + delay_slot + translate_goto(instr.immediate | (pc & 0xF0000000), last_index, reachable);
+
+        //rs is read before rd is written, and a target that isn't alligned exits before the delay slot
+        case OP_JR:
+        case OP_JALR:
+            return format("{ uint32_t target = r[%u]; ", rs) + ((instr.handler == OP_JALR && instr.rd != 0) ? format("r[%u] = 0x%08xu; ", instr.rd, pc + 8) : "")
+                + "if(target % 4 != 0){ exit(-11); } " + delay_slot + "pc = target; goto dispatch; }";
+    }
+
+    //the linking branches write $31 before reading rs, like the handlers do
+    std::string before = (instr.handler == OP_BGEZAL || instr.handler == OP_BLTZAL) ? link : "";
+
+    return before + "if(" + condition + "){ " + delay_slot + translate_goto(pc + instr.immediate, last_index, reachable) + " }";
+}
+
+int main(int argc, char *argv[]){
+
+    if(argc != 3){
+        std::cerr << "Usage: " << argv[0] << " input.bin output.cpp (a .bin, not an ELF file)" << std::endl;
+        exit(-20);
+    }
+
+    mips_memory memory;
+
+    ///////////////////////////////////////
+    ////////////  Loading File ////////////
+    ///////////////////////////////////////
+
+    std::ifstream file(argv[1], std::ios::binary | std::ios::ate);
+
+    if(!file.is_open()){
+        exit(-20);
+    }
+
+    std::streampos file_size = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    if(file_size > 0x1000000){
+        exit(-20);
+    }
+
+    std::vector<char> image(file_size);
+    file.read(image.data(), file_size);
+    file.close();
+
+    //the translation only knows a .bin: an ELF would be its header run as instructions, with no entry point or .data
+    if(elf_is_elf((const uint8_t*)image.data(), image.size())){
+        std::cerr << argv[1] << " is an ELF file, mips_translate needs a .bin" << std::endl;
+        exit(-20);
+    }
+
+    memory.set_INSTR_SIZE(file_size);
+    memory.copy_ADDR_INSTR(image.data());
+
+    std::vector<mips_decoded> program = program_decode(memory);
+
+
+    ///////////////////////////////////////
+    ///////////// Translating /////////////
+    ///////////////////////////////////////
+
+    std::ofstream out(argv[2]);
+
+    if(!out.is_open()){
+        exit(-20);
+    }
+
+    out << "//generated by mips_translate from " << argv[1] << ", do not edit\n\n";
+    out << "#include <cstdint>\n#include <cstdlib>\n#include <vector>\n\n";
+    out << "#include \"mips_simulator.hpp\"\n\n";
+
+    out << "//runs one instruction with its normal handler, and stops the same way the simulator would if it traps or exits\n";
+    out << "static inline void handler(const mips_decoded& instr, const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers){\n";
+    out << "    mips_status status = instruction_execute(instr, program, memory, registers);\n";
+    out << "    if(status != MIPS_OK){ exit(mips_exit_code(status, registers)); }\n";
+    out << "}\n\n";
+
+    out << "//runs the delay slot a taken branch left pending, if there is one, and stops the same way\n";
+    out << "static inline void delay_slot(const std::vector<mips_decoded>& program, mips_memory& memory, mips_registers& registers){\n";
+    out << "    if(!registers.in_delay_slot()){ return; }\n";
+    out << "    mips_status status = instruction_delay_slot(program, memory, registers);\n";
+    out << "    if(status != MIPS_OK){ exit(mips_exit_code(status, registers)); }\n";
+    out << "}\n\n";
+
+    out << "static const unsigned char image[] = {";
+    for(size_t i = 0; i < image.size(); i++){
+        out << ((i % 16 == 0) ? "\n    " : " ") << format("0x%02x,", (uint8_t)image[i]);
+    }
+    out << (image.empty() ? "0" : "") << "\n};\n\n";
+
+    out << "int main(){\n\n";
+    out << "    mips_memory memory;\n    mips_registers registers;\n\n";
+    out << "    memory.set_INSTR_SIZE(" << image.size() << ");\n";
+    out << "    memory.copy_ADDR_INSTR((const char*)image);\n\n";
+    out << "    //the handlers still run loads, stores, HI/LO and untranslated code\n";
+    out << "    std::vector<mips_decoded> program = program_decode(memory);\n\n";
+    out << "    uint32_t* r = registers.reg_pointer();\n";
+    out << "    uint32_t pc = 0x10000000;\n\n";
+
+    uint32_t last_address = memory.read_LAST_INSTR_ADDRESS();
+
+    if(last_address < 0x10000000){ //empty binary, the PC is out of range straight away
+        out << "    (void)r;\n    (void)pc;\n    exit(-11);\n}\n";
+        return 0;
+    }
+
+    uint32_t last_index = (last_address - 0x10000000) / 4;
+    std::vector<bool> reachable = find_reachable(program, last_index);
+
+    out << "    goto dispatch;\n\n";
+
+    //JR/JALR and handlers that changed the PC come back through here
+    out << "dispatch:\n";
+    out << "    if(pc == 0){ exit((uint8_t)r[2]); }\n";
+    out << "    switch(pc){\n";
+    for(uint32_t i = 0; i <= last_index; i++){
+        if(reachable[i]){
+            out << "        case 0x" << format("%08x", 0x10000000 + 4 * i) << "u: goto " << label(i) << ";\n";
+        }
+    }
+    out << "    }\n";
+    out << "    if(pc < 0x10000000 || pc > 0x" << format("%08x", last_address) << "u){ exit(-11); }\n";
+    out << "    //an address that wasn't found reachable: carry on with the block engine\n";
+    out << "    registers.next_instruction_branch(pc);\n";
+    out << "    {\n";
+    out << "        mips_block_engine blocks;\n";
+    out << "        uint64_t steps = UINT64_MAX;\n";
+    out << "        exit(mips_exit_code(blocks.run(program, memory, registers, steps), registers));\n";
+    out << "    }\n\n";
+
+    for(uint32_t i = 0; i <= last_index; i++){
+
+        if(!reachable[i]){
+            continue;
+        }
+
+        const mips_decoded& instr = program[i];
+
+        out << label(i) << ":\n    ";
+
+        if(instruction_is_branch(instr.handler)){
+            out << translate_branch(instr, i, program, last_index, reachable) << "\n";
+        }
+        else{
+            std::string statement = translate_simple(instr, i);
+            out << (statement.empty() ? ";" : statement) << "\n"; //a label needs a statement even when nothing needs doing (e.g. a write to $0)
+        }
+
+        //falling off the end of the binary
+        if(i == last_index && instr.handler != OP_J && instr.handler != OP_JR){
+            out << "    exit(-11);\n";
+        }
+    }
+
+    out << "}\n";
+
+    return 0;
+}
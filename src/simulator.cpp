@@ -2,12 +2,367 @@
 #include <fstream>
 #include <iostream>
 #include <vector>
+#include <sstream>
+#include <map>
+#include <cerrno>
+#include <cstdlib>
+#include <algorithm>
 
 #include <bitset>   //for testing, remove at the end
 
-#include "mips_memory.hpp"
-#include "mips_registers.hpp"
-#include "mips_breakdown.hpp"
+#include "mips_simulator.hpp"
+#include "mips_batch.hpp"
+#include "mips_devices.hpp"
+#include "mips_profile.hpp"
+#include "mips_timing.hpp"
+#include "mips_cache.hpp"
+#include "mips_console.hpp"
+
+#if defined(__unix__)
+#include <csignal>
+#include <sys/time.h>
+#include <unistd.h>
+#endif
+
+//exit codes when a limit stops the program, not the program itself (it still had more to run)
+static const int EXIT_INSTRUCTION_LIMIT = -30; //--max-instructions ran out
+static const int EXIT_TIME_LIMIT = -31;        //--max-wall-ms ran out
+
+//--batch=LIST: runs every line of LIST ("binary [input file [output file]]") as a job on a pool of threads. Each binary is only loaded once.
+//GETC reads the input file (nothing if there is none) and PUTC goes to the output file (dropped if there is none).
+//prints "binary exit_code" for every job, in the order of the list
+static int batch_main(const std::string& list_location, mips_engine engine, bool guard_pages, unsigned threads, uint64_t max_instructions){
+
+    std::ifstream list(list_location);
+
+    if(!list.is_open()){
+        return -20;
+    }
+
+    mips_batch batch(engine);
+    batch.set_guard_pages(guard_pages);
+
+    std::map<std::string, int> binary_number; //each binary is added once, however many jobs use it
+
+    std::vector<mips_job> jobs;
+    std::vector<std::string> names;
+    std::vector<std::string> outputs;
+
+    std::string line;
+
+    while(std::getline(list, line)){
+
+        std::istringstream fields(line);
+
+        std::string binary, input_location, output_location;
+
+        if(!(fields >> binary)){ //empty line
+            continue;
+        }
+
+        fields >> input_location >> output_location;
+
+        if(binary_number.count(binary) == 0){
+
+            binary_number[binary] = batch.add_binary(binary);
+
+            if(binary_number[binary] < 0){
+                return -20;
+            }
+        }
+
+        mips_job job;
+        job.binary = binary_number[binary];
+        job.max_steps = max_instructions;
+
+        if(!input_location.empty()){
+
+            std::ifstream input(input_location, std::ios::binary);
+
+            if(!input.is_open()){
+                return -20;
+            }
+
+            std::ostringstream contents;
+            contents << input.rdbuf();
+            job.input = contents.str();
+        }
+
+        jobs.push_back(job);
+        names.push_back(binary);
+        outputs.push_back(output_location);
+    }
+
+    batch.run(jobs, threads);
+
+    for(size_t i = 0; i < jobs.size(); i++){
+
+        if(!outputs[i].empty()){
+            std::ofstream output(outputs[i], std::ios::binary);
+            output << jobs[i].output;
+        }
+
+        //what the shell would see from a single run
+        int exit_code = (jobs[i].status == MIPS_STEP_LIMIT) ? EXIT_INSTRUCTION_LIMIT : jobs[i].exit_code;
+
+        std::cout << names[i] << " " << (int)(uint8_t)exit_code << "\n";
+    }
+
+    return 0;
+}
+
+
+//a whole decimal number from an option's value into value, false (value not changed) if there is anything else in it, or nothing at all
+static bool parse_number(const char* text, uint64_t& value, uint64_t max = UINT64_MAX){
+
+    if(*text < '0' || *text > '9'){ //strtoull would take a sign or spaces
+        return false;
+    }
+
+    errno = 0;
+
+    char* end;
+    unsigned long long number = std::strtoull(text, &end, 10);
+
+    if(*end != '\0' || errno == ERANGE || number > max){
+        return false;
+    }
+
+    value = number;
+
+    return true;
+}
+
+//parse_number() for the options that are 32 bit, exits with -20 if it isn't one
+static uint32_t option_number(const char* text){
+
+    uint64_t value;
+
+    if(!parse_number(text, value, UINT32_MAX)){
+        exit(-20);
+    }
+
+    return value;
+}
+
+
+///////////////////////////////////////
+//////////////  Watchdog //////////////
+///////////////////////////////////////
+
+//the wall clock limit is a timer signal that only sets out_of_time. Nothing polls the clock, the engines don't know about it: the run is cut
+//into slices with the step budget they already have (checked once a block), and out_of_time is looked at between them
+static volatile sig_atomic_t out_of_time = 0;
+static bool watching = false;
+
+//~10 ms at full speed, so stopping is late by about that much at most
+static const uint64_t WATCHDOG_SLICE = 1 << 22;
+
+#if defined(__unix__)
+
+//the program's console waits given up on by the watchdog, see watchdog_alarm
+static volatile sig_atomic_t gave_up_waiting = 0;
+
+static void watchdog_alarm(int){
+
+    if(gave_up_waiting){ //still running even so: stuck somewhere else, so that's it (without the reports)
+        _exit((uint8_t)EXIT_TIME_LIMIT);
+    }
+
+    if(out_of_time){ //a whole period more and still running: stuck somewhere a slice never ends (waiting for input/output)
+
+        //GETC/PUTC fail then, and the run stops like any other time limit, reports and all
+        mips_console::abandon();
+        gave_up_waiting = 1;
+
+        return;
+    }
+
+    out_of_time = 1;
+}
+
+static bool watchdog_start(uint64_t milliseconds){
+
+    struct sigaction action;
+    action.sa_handler = watchdog_alarm;
+    action.sa_flags = SA_RESTART;
+    sigemptyset(&action.sa_mask);
+
+    struct itimerval timer;
+    timer.it_value.tv_sec = milliseconds / 1000;
+    timer.it_value.tv_usec = (milliseconds % 1000) * 1000;
+    timer.it_interval = timer.it_value; //again after the same time for the last resort above
+
+    if(sigaction(SIGALRM, &action, NULL) != 0 || setitimer(ITIMER_REAL, &timer, NULL) != 0){
+        return false;
+    }
+
+    watching = true;
+
+    return true;
+}
+
+#else
+
+static bool watchdog_start(uint64_t){
+
+    return false;
+}
+
+#endif
+
+//simulator.run(max_steps), but it also stops (with MIPS_STEP_LIMIT) once out_of_time is set
+static mips_status run_watched(mips_simulator& simulator, uint64_t max_steps){
+
+    if(!watching){
+        return simulator.run(max_steps);
+    }
+
+    while(!out_of_time){
+
+        uint64_t slice = std::min(max_steps, WATCHDOG_SLICE);
+
+        mips_status status = simulator.run(slice);
+
+        if(status != MIPS_OK && status != MIPS_STEP_LIMIT){
+            return status;
+        }
+
+        if(max_steps != UINT64_MAX){ //UINT64_MAX is no limit, it never runs out
+
+            max_steps -= slice;
+
+            if(max_steps == 0){
+                return MIPS_STEP_LIMIT;
+            }
+        }
+    }
+
+    return MIPS_STEP_LIMIT;
+}
+
+//the exit code for the status the run stopped with, when there is a budget of steps it could have run out of
+static int limited_exit_code(mips_status status, mips_registers& registers){
+
+    if(status == MIPS_OK || status == MIPS_STEP_LIMIT){
+        return out_of_time ? EXIT_TIME_LIMIT : EXIT_INSTRUCTION_LIMIT;
+    }
+
+    if(status == MIPS_IO_ERROR && gave_up_waiting){ //the watchdog made it fail
+        return EXIT_TIME_LIMIT;
+    }
+
+    return mips_exit_code(status, registers);
+}
+
+
+///////////////////////////////////////
+//////////////  Profiles //////////////
+///////////////////////////////////////
+
+//--profile-mix=FILE counts the instruction mix of the run and writes it to FILE as CSV (see mips_mix_report)
+static std::string mixLocation;
+static mips_mix mix;
+
+//--profile-sample=PREFIX samples the PC every --profile-sample-us=N microseconds of CPU time (1000 by default) and writes
+//PREFIX.hot.csv (the hottest addresses) and PREFIX.folded (collapsed stacks, the caller from $31) for flamegraph tools
+static std::string sampleLocation;
+static mips_sampler* sampler = NULL;
+
+//--profile-calls=PREFIX counts an exact call graph and writes PREFIX.csv (self and inclusive instructions of every function) and PREFIX.folded
+//(collapsed stacks)
+static std::string callsLocation;
+static mips_callgraph* calls = NULL;
+
+//--timing=FILE runs the pipeline timing model (see mips_timing), so the program can read its cycle count at 0x30000008, and writes its
+//totals to FILE. --timing-load-use=N, --timing-branch=N, --timing-mult=N and --timing-div=N change its penalties and latencies
+static std::string timingLocation;
+static mips_timing* timing = NULL;
+
+//--cache=PREFIX runs an L1 instruction and data cache, --icache=SPEC and --dcache=SPEC say what they look like ("SIZE,WAYS,LINE[,lru|fifo|random][,wb|wt]",
+//16K,4,32,lru,wb by default, see mips_cache_config). Their counts go to PREFIX.csv, and with --cache-by-pc the misses of every instruction to
+//PREFIX.instr.csv and PREFIX.data.csv.
+//--trace and all of these can be on together, they all see every instruction
+static std::string cacheLocation;
+static mips_caches* caches = NULL;
+static bool cache_by_pc = false;
+
+//the names in the reports: --symbols=FILE (an nm listing) if given, otherwise the ELF's symbol table
+static std::string symbolsLocation;
+static std::vector<mips_symbol> symbols;
+
+//exit() for once the program has started running: the reports are written whichever way it stops, traps too
+static void exit_after_run(int code){
+
+    if(!mixLocation.empty()){
+
+        std::ofstream report(mixLocation);
+        mips_mix_report(mix, report);
+
+        if(!report){
+            exit(-20);
+        }
+    }
+
+    if(sampler != NULL){
+
+        sampler->stop();
+
+        std::ofstream hot(sampleLocation + ".hot.csv");
+        sampler->report_hot(hot, symbols);
+
+        std::ofstream folded(sampleLocation + ".folded");
+        sampler->report_collapsed(folded, symbols);
+
+        if(!hot || !folded){
+            exit(-20);
+        }
+    }
+
+    if(timing != NULL){
+
+        std::ofstream report(timingLocation);
+        timing->report(report);
+
+        if(!report){
+            exit(-20);
+        }
+    }
+
+    if(caches != NULL){
+
+        std::ofstream report(cacheLocation + ".csv");
+        caches->report(report);
+
+        if(cache_by_pc){
+
+            std::ofstream instr(cacheLocation + ".instr.csv");
+            caches->instr.report_pc(instr);
+
+            std::ofstream data(cacheLocation + ".data.csv");
+            caches->data.report_pc(data);
+        }
+
+        if(!report){
+            exit(-20);
+        }
+    }
+
+    if(calls != NULL){
+
+        std::ofstream functions(callsLocation + ".csv");
+        calls->report_functions(functions, symbols);
+
+        std::ofstream folded(callsLocation + ".folded");
+        calls->report_collapsed(folded, symbols);
+
+        if(!functions || !folded){
+            exit(-20);
+        }
+    }
+
+    exit(code);
+}
 
 
 int main(int argc, char *argv[]){ // argc stands for argument count, argv is a one-dimensional array of strings, each containing one of the arguments that was passed to the program.
@@ -19,80 +374,315 @@ int main(int argc, char *argv[]){ // argc stands for argument count, argv is a o
     }
 
 
-    mips_memory memory; //creating the memory object. It uses vectors of the correct size, filled with 0s
+    ///////////////////////////////////////
+    ///////////////  Options //////////////
+    ///////////////////////////////////////
 
-    mips_registers registers;
+    //options start with "--", the first argument that doesn't is the bin file
+    std::string binLocation;
 
+    mips_engine engine = ENGINE_BLOCKS; //--engine=blocks (default), --engine=jit, --engine=threaded or --engine=table
 
-    ///////////////////////////////////////
-    ////////////  Loading File ////////////
-    ///////////////////////////////////////
+    std::string batchLocation; //--batch=LIST runs a list of jobs instead of one bin file
+    unsigned threads = 0;      //--threads=N workers for --batch, one per core by default
 
-    std::string binLocation = argv[1]; //getting the location of the bin file from the argument
+    bool trace = false; //--trace prints every instruction to stderr before it runs
 
-   
+    bool guard_pages = false; //--memory=guard reserves the whole address space so loads/stores need no checks, --memory=paged (default) doesn't
 
-    std::ifstream file(binLocation, std::ios::binary | std::ios::ate ); //loads the file, the "ate" flag makes the pointer point to the end of the file, so tellg() shows the size of the file
+    //--checkpoint-at=N --checkpoint-file=F writes the state after N instructions to F (and carries on), --restore=F starts from it instead of
+    //the beginning, skipping those N. Checkpoints only fit the binary they were taken of
+    uint64_t checkpoint_at = UINT64_MAX;
+    std::string checkpointLocation;
+    std::string restoreLocation;
 
+    std::string blockLocation; //--block=FILE lets the program read FILE through a mips_block_device at 0x30000020
 
+    std::vector<std::string> dataImages; //--data-image=FILE[@OFFSET] puts FILE in ADDR_DATA at 0x20000000 + OFFSET before the program starts (can be given more than once)
 
-    if(file.is_open()){ 
-        
+    //--max-instructions=N stops the program after N instructions (exit code -30), --max-wall-ms=T after T milliseconds (-31).
+    //for --batch, --max-instructions is for each job
+    uint64_t max_instructions = UINT64_MAX;
+    uint64_t max_wall_ms = 0;
 
+    uint32_t sample_us = 1000;
 
-        std::streampos file_size = file.tellg(); //shows the size of the file
-        file.seekg(0, std::ios::beg); // go back to the begining of the file (as we opened with the pointer at the end.)
+    mips_timing_config timing_config;
 
+    mips_cache_config instr_config;
+    mips_cache_config data_config;
 
-        if(file_size > 0x1000000){ //if the file size is too big
+    for(int i = 1; i < argc; i++){
 
-            exit(-20);
+        std::string argument = argv[i];
+
+        if(argument == "--engine=blocks"){
+            engine = ENGINE_BLOCKS;
+        }
+        else if(argument == "--engine=jit"){
+            engine = ENGINE_JIT;
         }
+        else if(argument == "--engine=threaded"){
+            engine = ENGINE_THREADED;
+        }
+        else if(argument == "--engine=table"){
+            engine = ENGINE_TABLE;
+        }
+        else if(argument.compare(0, 8, "--batch=") == 0){
+            batchLocation = argument.substr(8);
+        }
+        else if(argument.compare(0, 10, "--threads=") == 0){
+            threads = option_number(argument.c_str() + 10);
+        }
+        else if(argument == "--trace"){
+            trace = true;
+        }
+        else if(argument == "--memory=guard"){
+            guard_pages = true;
+        }
+        else if(argument == "--memory=paged"){
+            guard_pages = false;
+        }
+        else if(argument.compare(0, 16, "--checkpoint-at=") == 0){
 
-        char *buffer = new char [file_size]; //allocate a temporary buffer to read the data
-        memory.set_INSTR_SIZE(file_size); //sets the memory size in bytes so we don't have to work it out again.
+            if(!parse_number(argument.c_str() + 16, checkpoint_at)){
+                exit(-20);
+            }
+        }
+        else if(argument.compare(0, 18, "--checkpoint-file=") == 0){
+            checkpointLocation = argument.substr(18);
+        }
+        else if(argument.compare(0, 10, "--restore=") == 0){
+            restoreLocation = argument.substr(10);
+        }
+        else if(argument.compare(0, 8, "--block=") == 0){
+            blockLocation = argument.substr(8);
+        }
+        else if(argument.compare(0, 13, "--data-image=") == 0){
+            dataImages.push_back(argument.substr(13));
+        }
+        else if(argument.compare(0, 19, "--max-instructions=") == 0){
+
+            if(!parse_number(argument.c_str() + 19, max_instructions)){
+                exit(-20);
+            }
+        }
+        else if(argument.compare(0, 14, "--max-wall-ms=") == 0){
+
+            if(!parse_number(argument.c_str() + 14, max_wall_ms) || max_wall_ms == 0){
+                exit(-20);
+            }
+        }
+        else if(argument.compare(0, 14, "--profile-mix=") == 0){
+            mixLocation = argument.substr(14);
+        }
+        else if(argument.compare(0, 17, "--profile-sample=") == 0){
+            sampleLocation = argument.substr(17);
+        }
+        else if(argument.compare(0, 20, "--profile-sample-us=") == 0){
+            sample_us = option_number(argument.c_str() + 20);
+        }
+        else if(argument.compare(0, 16, "--profile-calls=") == 0){
+            callsLocation = argument.substr(16);
+        }
+        else if(argument.compare(0, 9, "--timing=") == 0){
+            timingLocation = argument.substr(9);
+        }
+        else if(argument.compare(0, 18, "--timing-load-use=") == 0){
+            timing_config.load_use = option_number(argument.c_str() + 18);
+        }
+        else if(argument.compare(0, 16, "--timing-branch=") == 0){
+            timing_config.branch_penalty = option_number(argument.c_str() + 16);
+        }
+        else if(argument.compare(0, 14, "--timing-mult=") == 0){
+            timing_config.mult_latency = option_number(argument.c_str() + 14);
+        }
+        else if(argument.compare(0, 13, "--timing-div=") == 0){
+            timing_config.div_latency = option_number(argument.c_str() + 13);
+        }
+        else if(argument.compare(0, 8, "--cache=") == 0){
+            cacheLocation = argument.substr(8);
+        }
+        else if(argument.compare(0, 9, "--icache=") == 0){
 
-        file.read (buffer, file_size);
+            if(!instr_config.parse(argument.substr(9))){
+                exit(-20);
+            }
+        }
+        else if(argument.compare(0, 9, "--dcache=") == 0){
 
-        file.close();
+            if(!data_config.parse(argument.substr(9))){
+                exit(-20);
+            }
+        }
+        else if(argument == "--cache-by-pc"){
+            cache_by_pc = true;
+        }
+        else if(argument.compare(0, 10, "--symbols=") == 0){
+            symbolsLocation = argument.substr(10);
+        }
+        else if(argument.compare(0, 2, "--") == 0 || !binLocation.empty()){ //unknown option or more than one file
+            exit(-20);
+        }
+        else{
+            binLocation = argument; //getting the location of the bin file from the argument
+        }
+    }
 
+    if(!batchLocation.empty() && binLocation.empty()){
+        exit(batch_main(batchLocation, engine, guard_pages, threads, max_instructions));
+    }
 
-        memory.copy_ADDR_INSTR(buffer);
+    if(binLocation.empty() || !batchLocation.empty()){ //no file, or a file and a batch
+        exit(-20);
+    }
 
-        delete[] buffer;  //cleaning up
+    if((checkpoint_at != UINT64_MAX) != !checkpointLocation.empty()){ //one without the other
+        exit(-20);
     }
 
-    else{
-        //unable to open file, throw the corresponding error.
+
+    ///////////////////////////////////////
+    ////////////  Loading File ////////////
+    ///////////////////////////////////////
+
+    mips_simulator simulator(engine); //creates the memory (filled with 0s) and registers
+
+    if(!simulator.load_file(binLocation)){ //unable to open the file, or it is too big
 
         //std::cerr << "Unable to open file" << std::endl;
         exit(-20);
     }
 
-    
-    while(1){
+    if(trace){
+        simulator.set_trace(&std::cerr);
+    }
+
+    if(guard_pages){
+        simulator.set_guard_pages(true); //the results are the same paged, so carry on if the host can't
+    }
+
+    if(!mixLocation.empty()){
+        simulator.set_profile_mix(&mix);
+    }
+
+    if(!callsLocation.empty()){
+
+        calls = new mips_callgraph(simulator.get_registers().read_pc()); //left for exit_after_run
+        simulator.set_profile_calls(calls);
+    }
+
+    if(!timingLocation.empty()){
+
+        timing = new mips_timing(timing_config); //left for exit_after_run
+        simulator.set_timing(timing);
+    }
+
+    if(!cacheLocation.empty()){
+
+        caches = new mips_caches(instr_config, data_config); //left for exit_after_run
 
-        //PC gets set -> the instruction from PC becomes IR -> instruction executes (and sets the next PC)
+        if(cache_by_pc){
 
-        if(registers.read_pc() < 0x10000000 || registers.read_pc() > memory.read_LAST_INSTR_ADDRESS()){ //if it is out of range or reached the of of file wihtout going to the address 
-            
-            // std::cerr << "File ended or PC out of range" << std::endl;
-           
-            exit(-11);  
+            uint32_t instructions = simulator.get_memory().read_INSTR_SIZE() / 4;
 
+            caches->instr.count_by_pc(instructions);
+            caches->data.count_by_pc(instructions);
         }
 
-        //decode the instruction pointed at by the PC, and execute it. the PC is increased in the function, as they take account of branches etc.
-        instruction_decode_run(memory.read_INSTR(registers.read_pc()), memory, registers);
+        simulator.set_caches(caches);
+    }
+
+    if(symbolsLocation.empty()){
+        symbols = simulator.get_symbols();
+    }
+    else if(!mips_read_symbol_map(symbolsLocation, symbols)){
+        exit(-20);
+    }
+
+    for(size_t i = 0; i < dataImages.size(); i++){
+
+        std::string location = dataImages[i];
+        uint32_t offset = 0;
+
+        size_t at = location.rfind('@');
 
-        if(registers.read_reg(0) != 0){
-            registers.write_reg(0, 0);
+        if(at != std::string::npos){
+
+            char* end;
+            unsigned long value = std::strtoul(location.c_str() + at + 1, &end, 0); //decimal or 0x...
+
+            if(*end != '\0' || end == location.c_str() + at + 1 || value >= 0x4000000){
+                exit(-20);
+            }
+
+            offset = value;
+            location = location.substr(0, at);
+        }
+
+        if(!simulator.load_data_image(location, 0x20000000 + offset)){
+            exit(-20);
         }
     }
-    
 
-    return 1;
-}
+    if(!restoreLocation.empty() && !simulator.load_checkpoint(restoreLocation)){
+        exit(-20);
+    }
+
+    if(!blockLocation.empty()){
+
+        std::shared_ptr<const uint8_t> block;
+        size_t block_size;
+
+        if(!mips_map_file(blockLocation, block, block_size)){
+            exit(-20);
+        }
+
+        simulator.get_memory().attach_device(0x30000020, std::unique_ptr<mips_device>(new mips_block_device(block, block_size)));
+    }
+
+
+    ///////////////////////////////////////
+    ////////////////  Run /////////////////
+    ///////////////////////////////////////
+
+    //started here so loading doesn't count
+    if(max_wall_ms > 0 && !watchdog_start(max_wall_ms)){
+        exit(-20);
+    }
+
+    if(!sampleLocation.empty()){
 
+        sampler = new mips_sampler(); //left for exit_after_run
 
+        if(!sampler->start(simulator.get_registers(), sample_us)){
+            exit(-20);
+        }
+    }
+
+    if(checkpoint_at != UINT64_MAX){
+
+        mips_status status = run_watched(simulator, std::min(checkpoint_at, max_instructions));
+
+        if(status != MIPS_OK && status != MIPS_STEP_LIMIT){ //stopped before it got there, so there is nothing to carry on from
+            exit_after_run(mips_exit_code(status, simulator.get_registers()));
+        }
+
+        if(out_of_time || max_instructions < checkpoint_at){ //a limit came first
+            exit_after_run(limited_exit_code(status, simulator.get_registers()));
+        }
+
+        if(max_instructions != UINT64_MAX){
+            max_instructions -= checkpoint_at;
+        }
+
+        if(!simulator.save_checkpoint(checkpointLocation)){
+            exit_after_run(-20);
+        }
+    }
 
+    //with no limits it only returns when the program exits or traps
+    mips_status status = run_watched(simulator, max_instructions);
+
+    exit_after_run(limited_exit_code(status, simulator.get_registers()));
+}
@@ -0,0 +1,57 @@
+#include <cstdio>
+
+#include "mips_simulator.hpp"
+
+//the PC a trap leaves, which the exit code can't show: runs the binary three times on every engine (reset in between, so the JIT has
+//translated it by the last two) and prints "engine exit_code pc" with the PC in hex, or "engine differs" if the runs didn't all stop the same
+//usage: mips_trap_pc BINARY
+int main(int argc, char* argv[]){
+
+    if(argc != 2){
+        std::fprintf(stderr, "usage: %s BINARY\n", argv[0]);
+        return 1;
+    }
+
+    const mips_engine engines[] = {ENGINE_BLOCKS, ENGINE_THREADED, ENGINE_TABLE, ENGINE_JIT};
+    const char* names[] = {"blocks", "threaded", "table", "jit"};
+
+    for(int i = 0; i < 4; i++){
+
+        mips_simulator simulator(engines[i]);
+
+        if(!simulator.load_file(argv[1])){
+            std::fprintf(stderr, "can't load %s\n", argv[1]);
+            return 1;
+        }
+
+        int exit_code = 0;
+        uint32_t pc = 0;
+        bool same = true;
+
+        for(int run = 0; run < 3; run++){
+
+            simulator.reset();
+
+            mips_status status = simulator.run();
+
+            int run_exit_code = (uint8_t)mips_exit_code(status, simulator.get_registers());
+            uint32_t run_pc = simulator.get_registers().read_pc();
+
+            if(run > 0 && (run_exit_code != exit_code || run_pc != pc)){
+                same = false;
+            }
+
+            exit_code = run_exit_code;
+            pc = run_pc;
+        }
+
+        if(same){
+            std::printf("%s %d 0x%08x\n", names[i], exit_code, pc);
+        }
+        else{
+            std::printf("%s differs\n", names[i]);
+        }
+    }
+
+    return 0;
+}